@@ -2,19 +2,39 @@
 
 #include <SFML/Graphics.hpp>
 #include <carnn/neural/fwd.hpp>
+#include <cstdint>
+#include <vector>
 
 namespace neural
 {
+/// Draws a network: neurons laid out by layer, synapses as lines, both colored after the current neuron values.
+///
+/// The layout, vertex arrays and labels are built once per network topology and kept for as long as the displayed
+/// networks share it. Frames where it did not change only recolor the vertices, and draw synapses and neurons in one
+/// call each.
 class Visualizer
 {
 	public:
-	Visualizer(const Network& network);
-
-	void display(sf::RenderTarget& target, sf::Font& font);
+	void display(sf::RenderTarget& target, const sf::Font& font, const Network& network);
 
 	private:
-	sf::Vector2f neuron_offset(NeuronPosition pos);
+	/// Rebuilds `_next_signature` from `network`, returns whether it differs from the current layout
+	bool topology_changed(const sf::Font& font, const Network& network);
+
+	void build_layout(const sf::Font& font, const Network& network);
+	void update_colors(const Network& network);
+
+	sf::Vector2f neuron_offset(NeuronPosition pos, std::size_t layer_size) const;
+
+	/// Layer sizes, synapse ends and neuron labels the layout was built for
+	std::vector<std::uint64_t> _signature, _next_signature;
+	const sf::Font*            _font = nullptr;
+
+	/// Screen position of every neuron, by neuron id
+	std::vector<sf::Vector2f> _neuron_origins;
 
-	const Network* _network;
+	sf::VertexArray       _synapse_lines{sf::Lines};
+	sf::VertexArray       _neuron_circles{sf::Triangles};
+	std::vector<sf::Text> _labels;
 };
 } // namespace neural
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <carnn/sim/fwd.hpp>
+#include <carnn/sim/topology.hpp>
+#include <cereal/cereal.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace sim
+{
+struct TuningResult
+{
+	Topology topology;
+
+	std::size_t unit_count    = 0;
+	std::size_t cars_per_unit = 0;
+
+	/// Whether the unit count was picked by calibration rather than set in the simulation settings
+	bool calibrated = false;
+
+	/// Average duration of a tick for the picked unit count during calibration, or 0 if none happened
+	double seconds_per_tick = 0.0;
+
+	template<class Archive>
+	void serialize(Archive& ar)
+	{
+		ar(CEREAL_NVP(topology),
+		   CEREAL_NVP(unit_count),
+		   CEREAL_NVP(cars_per_unit),
+		   CEREAL_NVP(calibrated),
+		   CEREAL_NVP(seconds_per_tick));
+	}
+};
+
+/// Picks how many simulation units to spread the population over for the machine we run on.
+///
+/// Too many units waste memory and setup time on duplicated worlds, too few leave cores idle or units whose cars do
+/// not fit in cache. The tuner derives a few candidate unit counts from the core count and cache sizes, times a short
+/// tick loop for each of them and keeps the cheapest one.
+class AutoTuner
+{
+	public:
+	AutoTuner(Topology topology, Placement& placement);
+
+	/// Calibrates with `population` driving the cars, unless `settings.unit_count` overrides it.
+	/// The result is logged and written to tuning.json.
+	TuningResult tune(
+		const MapSettings&        map,
+		const SimulationSettings& settings,
+		std::vector<Individual>&  population,
+		const TickStages&         stages);
+
+	private:
+	std::vector<std::size_t> candidate_unit_counts(std::size_t population_size) const;
+
+	double measure(
+		const MapSettings&        map,
+		const SimulationSettings& settings,
+		std::size_t               unit_count,
+		std::vector<Individual>&  population,
+		const TickStages&         stages) const;
+
+	void report(const TuningResult& result) const;
+
+	Topology   _topology;
+	Placement& _placement;
+};
+} // namespace sim
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <box2d/box2d.h>
+#include <carnn/sim/fwd.hpp>
+#include <vector>
+
+namespace sim
+{
+struct CarSnapshot;
+
+/// Draws many cars at once: their bodies, wheels and rays all go into two vertex arrays, so that a frame costs two
+/// draw calls however many cars there are.
+///
+/// The outlines of the car and wheel shapes are computed once in local space, cars only get transformed by their
+/// Box2D pose. Vertex storage is kept from one frame to the next.
+class CarRenderer
+{
+	public:
+	CarRenderer();
+
+	void clear();
+
+	void add(const CarSnapshot& car, sf::Color fill);
+
+	void draw(sf::RenderTarget& target) const;
+
+	private:
+	/// A convex outline, as the triangles filling it and the triangles of its border, in local space
+	struct Mesh
+	{
+		std::vector<b2Vec2> fill;
+		std::vector<b2Vec2> border;
+	};
+
+	static Mesh make_mesh(const std::array<b2Vec2, 8>& vertices, float border_thickness);
+
+	void add_mesh(const Mesh& mesh, const b2Transform& transform, sf::Color fill, sf::Color border);
+
+	Mesh _car_mesh, _wheel_mesh;
+
+	sf::VertexArray _triangles{sf::Triangles};
+	sf::VertexArray _lines{sf::Lines};
+};
+} // namespace sim
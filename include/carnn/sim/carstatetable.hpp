@@ -0,0 +1,114 @@
+#pragma once
+
+#include <algorithm>
+#include <box2d/box2d.h>
+#include <carnn/neural/fwd.hpp>
+#include <carnn/sim/entities/car.hpp>
+#include <carnn/sim/fwd.hpp>
+#include <carnn/sim/settings.hpp>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace sim
+{
+/// What the controllers of the cars of a unit read and write every tick, as structure of arrays indexed like
+/// `SimulationUnit::cars`.
+///
+/// A tick gathers the kinematics of the live cars out of Box2D, runs the sensor, inference and actuation stages over
+/// these arrays only, then scatters the controls back to the cars before stepping the world. Race progress (target
+/// checkpoint, fitness, death) stays on the cars, which update it as they move.
+class CarStateTable
+{
+	public:
+	void resize(std::size_t car_count, std::size_t ray_count);
+
+	std::size_t ray_count() const { return ray_angle.size(); }
+
+	/// Clears the sensors and controls of every car, for a new run
+	void reset();
+
+	/// Copies the pose, velocities and objective of the live cars out of the physics world
+	void gather(const std::vector<entities::Car*>& cars, const std::vector<std::uint32_t>& live_cars);
+
+	/// Same, for cars moved by `kinematics` rather than by Box2D
+	void gather(
+		const std::vector<entities::Car*>& cars,
+		const CarKinematics&               kinematics,
+		const std::vector<std::uint32_t>&  live_cars);
+
+	/// Sensor stage, batched over the live cars: the direction to their objective relative to their heading, and the
+	/// direction of each of their rays. Only takes dot and cross products, and a table for the ray angles.
+	void sense(const std::vector<std::uint32_t>& live_cars);
+
+	/// Hands the controls of the live cars to the physics world
+	void scatter(const std::vector<entities::Car*>& cars, const std::vector<std::uint32_t>& live_cars) const;
+
+	/// Whether a ray of a car gets cast this tick, according to `ray_schedule`
+	bool ray_due(std::size_t car, std::size_t ray) const
+	{
+		switch (ray_schedule)
+		{
+		case RaySchedule::EveryTick: return true;
+
+		case RaySchedule::Adaptive:
+		{
+			// the faster the car, the shorter the period, every tick at full speed
+			const float slowness = 1.0f - std::min(forward_speed[car] / full_speed, 1.0f);
+			return (ray + ray_ticks) % (1 + std::size_t(float(ray_period - 1) * slowness + 0.5f)) == 0;
+		}
+
+		case RaySchedule::RoundRobin:
+		default: return (ray + ray_ticks) % ray_period == 0;
+		}
+	}
+
+	std::pair<b2Vec2, b2Vec2> ray_segment(std::size_t car, std::size_t ray) const;
+
+	void set_ray_result(std::size_t car, std::size_t ray, float closest_fraction)
+	{
+		ray_fraction[ray][car] = closest_fraction;
+	}
+
+	/// Appends the segments of the rays of a car up to what they hit, colored by distance, as drawn by the UI
+	void append_ray_vertices(std::size_t car, std::vector<sf::Vertex>& vertices) const;
+
+	/// Fills the input layer of the network driving a car from the output of `sense`
+	void load_inputs(std::size_t car, neural::Network& network) const;
+
+	/// Actuation stage: turns the output layer of the network driving a car into controls
+	void store_outputs(std::size_t car, const neural::Network& network);
+
+	static constexpr float ray_radius = 96.0f;
+
+	/// Forward speed fed to the networks as a full input
+	static constexpr float full_speed = 6.0f;
+
+	// gathered from the physics world
+	std::vector<float>        position_x, position_y;
+	std::vector<float>        heading_cos, heading_sin; ///< of the body angle
+	std::vector<float>        forward_speed, lateral_speed;
+	std::vector<float>        objective_x, objective_y;
+	std::vector<std::uint8_t> has_objective;
+
+	// sensors
+	std::vector<float>              objective_cos, objective_sin; ///< of the angle from the objective to the heading
+	std::vector<std::vector<float>> ray_angle;    ///< per ray, 0..1, fraction of a half turn to the right
+	std::vector<std::vector<float>> ray_dir_x;    ///< per ray, direction of the ray scaled by `ray_radius`
+	std::vector<std::vector<float>> ray_dir_y;
+	std::vector<std::vector<float>> ray_fraction; ///< per ray, of `ray_radius` at which the ray hit a wall
+	std::size_t                     ray_ticks = 0;
+
+	RaySchedule ray_schedule = RaySchedule::RoundRobin;
+	std::size_t ray_period   = 2;
+
+	// controls, scattered to the physics world
+	std::vector<float> throttle, steering, brake, drift;
+
+	/// Network driving each car, set when individuals are attached to the cars
+	std::vector<neural::Network*> network;
+
+	private:
+	void gather_car(std::size_t i, const entities::Car& car, b2Vec2 position, const b2Rot& rot, b2Vec2 velocity);
+};
+} // namespace sim
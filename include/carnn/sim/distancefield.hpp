@@ -0,0 +1,39 @@
+#pragma once
+
+#include <box2d/box2d.h>
+#include <carnn/util/line.hpp>
+#include <vector>
+
+namespace sim
+{
+/// Distance from any point of the map to the closest wall segment, sampled on a regular grid.
+///
+/// Walls are zero-thickness segments, so there is no inside to speak of and the field is unsigned. Lookups return the
+/// nearest sample: since the distance is 1-Lipschitz, a lookup is off by at most `lookup_error()`, which is what the
+/// ray marcher relies on to never step through a wall.
+class DistanceField
+{
+	public:
+	DistanceField(const std::vector<util::Line>& walls, float resolution);
+
+	/// Distance to the closest wall, or +inf when `p` is outside of the sampled area (which has no walls past it).
+	float distance(b2Vec2 p) const;
+
+	/// Sphere-traces the segment p1 -> p2 and returns the fraction at which a wall was hit, or 1 if none was.
+	/// The returned fraction never goes past the exact hit, and the point it describes lies within `max_error()` of a
+	/// wall. For rays grazing a wall, the error along the ray can be larger than that.
+	float raycast(b2Vec2 p1, b2Vec2 p2) const;
+
+	float resolution() const { return _resolution; }
+	float lookup_error() const;
+	float max_error() const;
+
+	private:
+	float _resolution;
+
+	b2Vec2      _origin;
+	std::size_t _width = 0, _height = 0;
+
+	std::vector<float> _distances;
+};
+} // namespace sim
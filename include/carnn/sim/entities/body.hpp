@@ -1,9 +1,7 @@
 #pragma once
 
-#include <SFML/Graphics.hpp>
 #include <box2d/box2d.h>
 #include <carnn/sim/fwd.hpp>
-#include <vector>
 
 namespace sim::entities
 {
@@ -12,7 +10,6 @@ enum class BodyType
 	BodyAny = 0,
 	BodyCar,
 	BodyWheel,
-	BodyCheckpoint,
 	BodyWall
 };
 
@@ -25,17 +22,14 @@ struct BodyUserData
 class Body
 {
 	public:
-	Body(World& world, const b2BodyDef bdef, const bool do_render = true);
-	virtual ~Body() {}
+	Body(World& world, const b2BodyDef bdef);
 
 	// Delete move and copy constructors
 	Body(const Body&)  = delete;
 	Body(const Body&&) = delete;
 
-	virtual void update();
-	virtual void render(sf::RenderTarget& target);
-
-	void set_type(const BodyType type);
+	void     set_type(const BodyType type);
+	BodyType type() const { return _bud.type; }
 
 	b2Vec2 front_normal() const;
 	b2Vec2 lateral_normal() const;
@@ -45,19 +39,12 @@ class Body
 
 	b2Fixture& add_fixture(const b2FixtureDef fdef);
 
-	Body& with_color(const sf::Color c, uint8_t outline_alpha = 255);
-
 	World& world();
 
 	b2Body&    get();
 	b2BodyDef& definition();
 
 	protected:
-	bool _do_render;
-
-	std::vector<std::unique_ptr<sf::Shape>> _shapes;
-	sf::Color                               _next_color;
-
 	BodyUserData _bud;
 
 	b2BodyDef _bdef;
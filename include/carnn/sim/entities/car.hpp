@@ -3,10 +3,10 @@
 #include <carnn/neural/fwd.hpp>
 #include <carnn/sim/entities/body.hpp>
 #include <carnn/sim/fwd.hpp>
+#include <carnn/sim/settings.hpp>
+#include <array>
 #include <vector>
 
-constexpr size_t total_rays = 3;
-
 namespace sim::entities
 {
 enum AxonControl : size_t
@@ -20,7 +20,8 @@ enum AxonControl : size_t
 	Axon_FirstRay
 };
 
-class CarCheckpointListener : public b2ContactListener
+/// Kills the cars that touch a wall
+class CarWallListener : public b2ContactListener
 {
 	void BeginContact(b2Contact* contact) override;
 	void EndContact(b2Contact* contact) override;
@@ -29,20 +30,28 @@ class CarCheckpointListener : public b2ContactListener
 class Car : public Body
 {
 	public:
-	Car(World& world, const b2BodyDef bdef, const bool do_render = true);
+	Car(World& world, const b2BodyDef bdef);
 
-	void update() override;
-	void render(sf::RenderTarget& target) override;
-	void fast_render(sf::RenderTarget& target);
+	/// Outlines of the car body and of its wheels, in local space
+	static const std::array<b2Vec2, 8> body_vertices, wheel_vertices;
 
-	void        contact_checkpoint(Checkpoint& cp);
-	void        set_target_checkpoint(Checkpoint* cp);
-	std::size_t reached_checkpoints() const;
+	/// Where the wheels are mounted on the body, in local space. The first two are the steering ones.
+	static const std::array<b2Vec2, 4> wheel_anchors;
 
-	b2Vec2 direction_to_objective() const;
+	/// Updates the race progress of the car from its motion since the last update, then the car and its wheels
+	void update();
+
+	std::size_t reached_checkpoints() const;
 
 	const std::vector<Wheel*>& get_wheels() const { return _wheels; }
 
+	/// World transform of the car body, read from CarKinematics under the kinematic model, whose Box2D body stays put
+	b2Transform body_transform() const;
+
+	/// World transform of a wheel, whether or not it has a body of its own under the current vehicle model
+	b2Transform wheel_transform(std::size_t wheel) const;
+
+	/// Fitness as of the last `update`, cheap enough to call anywhere
 	float fitness() const;
 	void  fitness_penalty(float value);
 
@@ -55,26 +64,42 @@ class Car : public Body
 
 	void transform(const b2Vec2 pos, const float angle);
 
-	void compute_raycasts();
+	/// Brings the car and its wheels to a stop at the given pose and clears all of its race state. The vehicle
+	/// model holds until the next reset.
+	void reset(const b2Vec2 pos, const float angle, VehicleModel model);
 
-	void update_inputs(neural::Network& n);
+	const Checkpoint* target_checkpoint() const { return _target_checkpoint; }
 
 	bool dead = false;
 
 	// TODO: make this less garbage
 	SimulationUnit* unit       = nullptr;
+	std::uint32_t   unit_index = 0; ///< index of the car in `unit->cars`
 	Individual*     individual = nullptr;
 
-	// yolo
-	std::array<double, total_rays> _ray_angles{};
-
 	private:
-	std::array<sf::Vertex, total_rays * 2> _rays{};
-	std::vector<Wheel*>                    _wheels;
-	std::array<b2RevoluteJoint*, 2>        _front_joints{};
+	/// Takes the car and its wheels out of the physics world once it died
+	void retire();
 
-	std::array<double, total_rays> _ray_distances{};
-	std::size_t                    _ray_update_frequency = 0;
+	/// Moves on to the next checkpoint if the segment went across the target one, or penalizes the car if it went
+	/// back across the latest one
+	void cross_checkpoints(b2Vec2 from, b2Vec2 to);
+
+	/// Refreshes the cached fitness from the progress along the stretch of track leading to the target checkpoint, as
+	/// parameterized by the map
+	void update_fitness();
+
+	/// Gives the body the mass and inertia of the whole car, wheels included, for the single body model
+	void carry_wheel_mass();
+
+	std::vector<Wheel*>             _wheels;
+	std::array<b2RevoluteJoint*, 2> _front_joints{};
+
+	VehicleModel _model = VehicleModel::Wheeled;
+
+	// single body model: the steering angle of the front wheels, and the one `steer` asked for, which like a joint
+	// limit only takes effect over the next step
+	float _steer_angle = 0.0f, _next_steer_angle = 0.0f;
 
 	std::size_t _reached_checkpoints = 0;
 
@@ -82,14 +107,18 @@ class Car : public Body
 
 	float _brake_amount = 0.0f;
 
-	mutable float _fitness      = 0.0f;
-	float         _fitness_bias = 0.0f;
+	float _fitness      = 0.0f;
+	float _fitness_bias = 0.0f;
 
 	float _acceleration_factor = 1.0f;
 
-	Checkpoint* _latest_checkpoint = nullptr;
-	Checkpoint* _target_checkpoint = nullptr;
+	const Checkpoint* _latest_checkpoint = nullptr;
+	const Checkpoint* _target_checkpoint = nullptr;
+
+	b2Vec2 _previous_position{0.0f, 0.0f}; ///< as of the last update
+
+	static constexpr float _angle_lock = 0.8f, _turn_speed = 1.0f;
 
-	const float _angle_lock = 0.8f, _turn_speed = 1.0f;
+	friend class sim::CarKinematics;
 };
 } // namespace sim::entities
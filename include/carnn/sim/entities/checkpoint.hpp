@@ -1,17 +1,20 @@
 #pragma once
 
-#include <carnn/sim/entities/body.hpp>
+#include <SFML/System/Vector2.hpp>
+#include <cstddef>
 
 namespace sim::entities
 {
-class Checkpoint : public Body
+/// A line across the track that cars have to go through in order. Not a physics body: each car tests its own motion
+/// against its target and latest checkpoints, see Car::update.
+struct Checkpoint
 {
-	public:
-	Checkpoint(World& world, const b2BodyDef bdef, const bool do_render = true);
-
 	std::size_t id;
 
 	sf::Vector2f origin;
 	sf::Vector2f p1, p2;
+
+	/// See CheckpointLine::progress_origin
+	sf::Vector2f progress_origin, progress_axis;
 };
 } // namespace sim::entities
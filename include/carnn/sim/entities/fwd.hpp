@@ -5,7 +5,7 @@ namespace sim::entities
 struct BodyUserData;
 class Body;
 class Car;
-class CarCheckpointListener;
-class Checkpoint;
+class CarWallListener;
+struct Checkpoint;
 class Wheel;
 }
@@ -7,13 +7,22 @@ namespace sim::entities
 class Wheel : public Body
 {
 	public:
-	Wheel(World& world, const b2BodyDef bdef, const bool do_render = true);
+	Wheel(World& world, const b2BodyDef bdef);
 
 	void cancel_lateral_force(const float multiplier);
 	void drag(float brake_intensity);
 	void accelerate(float throttle); // power -1..1
 
+	// Same tire forces, for a wheel of the given mass and inertia mounted at `anchor` (in local space) on `body` and
+	// turned by `angle` relative to it. Used by the single body vehicle model, where wheels have no body of their own.
+	static void cancel_lateral_force(
+		b2Body& body, b2Vec2 anchor, float angle, float mass, float inertia, const float multiplier);
+	static void drag(b2Body& body, b2Vec2 anchor, float angle, float brake_intensity);
+	static void accelerate(b2Body& body, b2Vec2 anchor, float angle, float throttle);
+
 	private:
+	friend class sim::CarKinematics;
+
 	static constexpr float _drag = -10.0f, _brake_drag = -60.0f, _impulse_magnitude = .1f, _forward_mul = 0.15f,
 						   _backwards_mul = 0.05f, _max_accel_force = 600.f, _max_lateral_impulse = 15.f;
 };
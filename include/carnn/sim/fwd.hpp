@@ -4,8 +4,20 @@
 
 namespace sim
 {
+class CarKinematics;
+class CarStateTable;
+class DistanceField;
 struct Individual;
+class Leaderboard;
+class Map;
+struct MapSettings;
+class Placement;
+class RayBatch;
 class Simulation;
 class SimulationUnit;
+struct SimulationSettings;
+struct Snapshot;
+struct TickStages;
+class WallGrid;
 class World;
 }
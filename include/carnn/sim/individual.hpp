@@ -1,7 +1,9 @@
 #pragma once
 
 #include <carnn/neural/network.hpp>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 
 namespace sim
 {
@@ -13,6 +15,12 @@ struct Individual
 
 	bool   survivor_from_last = false;
 
+	static constexpr std::size_t no_node = std::numeric_limits<std::size_t>::max();
+
+	/// NUMA node Simulation::attach last copied `network` to, `no_node` once the network was rebuilt anywhere else.
+	/// Not saved, as loaded networks are allocated by whichever thread loads them.
+	std::size_t network_node = no_node;
+
 	template<class Archive>
 	void serialize(Archive& ar)
 	{
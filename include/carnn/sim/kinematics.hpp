@@ -0,0 +1,63 @@
+#pragma once
+
+#include <box2d/box2d.h>
+#include <carnn/sim/fwd.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace sim
+{
+/// Integrates the cars of a unit outside of Box2D, for VehicleModel::Kinematic.
+///
+/// Each car is a rigid body carrying its wheels' mass and applying the tire forces of the single body model, so it
+/// drives like a VehicleModel::SingleBody car as long as it touches nothing. Cars never collide with each other and die
+/// when touching a wall, so there are no contacts to solve: walls are only tested for overlap against the WallGrid.
+/// The Box2D bodies of the cars stay disabled and are never touched while the model runs; the cars read their pose
+/// from here instead.
+///
+/// State is kept as structure of arrays indexed like `SimulationUnit::cars`. Steps follow the order of a Box2D tick:
+/// controls, integration, then the tire impulses and the drag that the next integration applies. Integration runs
+/// over the contiguous columns of all the cars without branching nor trigonometry, dead cars being masked out, so
+/// that it vectorizes.
+class CarKinematics
+{
+	public:
+	/// Takes the pose and mass properties of the cars, which must have just been reset
+	void load(const std::vector<entities::Car*>& cars);
+
+	/// Moves the cars by `seconds` according to the controls in `state`, and flags the live ones that touched a wall
+	void step(
+		const CarStateTable&              state,
+		const std::vector<std::uint32_t>& live_cars,
+		const WallGrid&                   walls,
+		float                             seconds);
+
+	/// Stops moving a car, which keeps its last pose
+	void freeze(std::size_t car) { moving[car] = 0.0f; }
+
+	b2Transform transform(std::size_t car) const;
+
+	std::size_t size() const { return position_x.size(); }
+
+	std::vector<float> position_x, position_y;                   ///< of the body origin
+	std::vector<float> rotation_c, rotation_s;                   ///< cosine and sine of the body angle
+	std::vector<float> previous_x, previous_y;                   ///< body origin before the last step
+	std::vector<float> velocity_x, velocity_y, angular_velocity; ///< of the center of mass
+	std::vector<float> steer_angle;
+	std::vector<float> drag_x, drag_y, drag_torque; ///< computed after a step, applied during the next one
+	std::vector<float> moving;                      ///< 1 for the cars still alive, 0 once frozen
+
+	std::vector<std::uint8_t> hit_wall;
+
+	private:
+	/// Steps every car, live or frozen
+	void integrate(const CarStateTable& state, float seconds);
+
+	bool overlaps_wall(std::size_t car, const WallGrid& walls) const;
+
+	b2Vec2 _local_center{0.0f, 0.0f};
+	float  _mass = 1.0f, _inertia = 1.0f; ///< inertia about the center of mass
+	float  _wheel_mass = 0.0f, _wheel_inertia = 0.0f;
+	float  _angular_damping = 0.0f;
+};
+} // namespace sim
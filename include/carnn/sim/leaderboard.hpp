@@ -0,0 +1,37 @@
+#pragma once
+
+#include <carnn/sim/fwd.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace sim
+{
+/// The best cars of a simulation, best first.
+///
+/// Cars cache their fitness once per tick, so refreshing the leaderboard only takes reading N floats and keeping the
+/// best K of them in a heap, in O(N log K), instead of sorting the whole population.
+class Leaderboard
+{
+	public:
+	struct Entry
+	{
+		float          fitness;
+		entities::Car* car;
+	};
+
+	explicit Leaderboard(std::size_t capacity = 100);
+
+	/// Ranks `cars` again from their cached fitness
+	void update(const std::vector<entities::Car*>& cars);
+
+	/// At most `capacity` entries, best first
+	const std::vector<Entry>& entries() const { return _entries; }
+
+	/// Best car as of the last update, or nullptr if there is none
+	entities::Car* best() const { return _entries.empty() ? nullptr : _entries.front().car; }
+
+	private:
+	std::size_t        _capacity;
+	std::vector<Entry> _entries;
+};
+} // namespace sim
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <box2d/box2d.h>
+#include <carnn/sim/fwd.hpp>
+#include <carnn/util/line.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace sim
+{
+struct MapSettings
+{
+	std::string map_path;
+	std::string checkpoint_path;
+	bool flip = false;
+};
+
+struct CheckpointLine
+{
+	sf::Vector2f origin;
+	sf::Vector2f p1, p2;
+
+	/// Parameterizes the stretch of track leading to this checkpoint from the previous one: a position `p` is
+	/// `dot(p - progress_origin, progress_axis)` of the way there, 0 at the middle of the previous checkpoint line and
+	/// 1 at the middle of this one.
+	sf::Vector2f progress_origin, progress_axis;
+};
+
+/// Static geometry of a race, loaded once from its files and shared (read-only) by every unit simulating it.
+class Map
+{
+	public:
+	/// Loads the map, or returns the already loaded one if these settings were seen before
+	static std::shared_ptr<const Map> load(const MapSettings& settings);
+
+	Map(MapSettings settings);
+
+	/// Distance field of the walls at the given resolution, built on first use
+	std::shared_ptr<const DistanceField> distance_field(float resolution) const;
+
+	MapSettings settings;
+
+	std::vector<util::Line> walls;
+	std::vector<sf::Vertex> wall_vertices;
+	b2Vec2                  car_origin;
+
+	/// Checkpoints in race order, i.e. already reversed for flipped maps
+	std::vector<CheckpointLine> checkpoints;
+	sf::VertexArray             checkpoint_vertices;
+
+	std::unique_ptr<const WallGrid> wall_grid;
+
+	private:
+	void load_walls();
+	void load_checkpoints();
+
+	/// Fills the progress parameterization of the checkpoints, once they are in race order
+	void measure_checkpoints();
+
+	mutable std::mutex                                            _distance_fields_mutex;
+	mutable std::map<float, std::shared_ptr<const DistanceField>> _distance_fields;
+};
+} // namespace sim
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <carnn/sim/topology.hpp>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <tbb/tbb.h>
+#include <utility>
+#include <vector>
+
+namespace sim
+{
+/// Keeps simulation units, their memory and the threads ticking them on the same NUMA node.
+///
+/// Units are split in contiguous ranges, one per node, sized after the share of simulation threads of the node. Each
+/// node gets its own task arena whose threads are pinned to the CPUs of the node. Anything a unit allocates while
+/// being built or ticked from `for_each_unit` is thus first touched, and so backed by memory, on its node. With a
+/// single node, nothing gets pinned.
+///
+/// The arenas do not reserve any slot for the calling thread: work is enqueued in them and the caller only sleeps until
+/// it is done, so that the UI thread never ends up running a long simulation task.
+class Placement
+{
+	public:
+	/// Spreads `thread_count` simulation threads over the nodes of `topology`, 0 meaning one less than the core count
+	Placement(const Topology& topology, std::size_t thread_count);
+	~Placement();
+
+	Placement(const Placement&) = delete;
+	Placement& operator=(const Placement&) = delete;
+
+	std::size_t node_count() const { return _nodes.size(); }
+
+	std::size_t thread_count() const { return _thread_count; }
+
+	/// Units `[first, last)` out of `unit_count` that live on `node`
+	std::pair<std::size_t, std::size_t> unit_range(std::size_t node, std::size_t unit_count) const;
+
+	/// Runs `f(node)` for every node, from the threads of that node, and blocks until all of them are done.
+	/// Must not be called from a simulation thread.
+	template<class F>
+	void for_each_node(F&& f)
+	{
+		std::size_t remaining = _nodes.size();
+
+		for (std::size_t i = 0; i < _nodes.size(); ++i)
+		{
+			_nodes[i]->arena->enqueue([&, i] {
+				f(i);
+
+				std::lock_guard lock(_done_mutex);
+				if (--remaining == 0)
+				{
+					_done.notify_one();
+				}
+			});
+		}
+
+		std::unique_lock lock(_done_mutex);
+		_done.wait(lock, [&] { return remaining == 0; });
+	}
+
+	/// Runs `f(unit_index)` for every unit index in `[0, unit_count)`, from the threads of the node of the unit
+	template<class F>
+	void for_each_unit(std::size_t unit_count, F&& f)
+	{
+		for_each_node([&](const std::size_t node) {
+			const auto range = unit_range(node, unit_count);
+			tbb::parallel_for(range.first, range.second, [&](const std::size_t unit_index) { f(unit_index); });
+		});
+	}
+
+	private:
+	class PinningObserver;
+
+	struct Node
+	{
+		std::size_t thread_count = 1;
+
+		std::unique_ptr<tbb::task_arena> arena;
+
+		/// Declared after the arena so that it stops observing it before the arena goes away
+		std::unique_ptr<PinningObserver> pinning;
+	};
+
+	std::vector<std::unique_ptr<Node>> _nodes;
+	std::size_t                        _thread_count = 1;
+
+	/// Makes sure TBB spawns enough workers to fill every arena
+	std::unique_ptr<tbb::global_control> _parallelism;
+
+	std::mutex              _done_mutex;
+	std::condition_variable _done;
+};
+} // namespace sim
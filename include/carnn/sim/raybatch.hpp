@@ -0,0 +1,48 @@
+#pragma once
+
+#include <box2d/box2d.h>
+#include <carnn/sim/fwd.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace sim
+{
+/// Collects the rays of all the cars of a unit to cast them in one go against a WallGrid.
+///
+/// Rays are bucketed by the grid cells they go through, and each cell is tested against all of its rays at once, the
+/// rays being the vector lanes. Buffers are only ever cleared, so a batch stops growing once it has seen its largest
+/// tick.
+class RayBatch
+{
+	public:
+	void clear();
+
+	/// Makes room for queuing `ray_count` rays. The cell buckets `cast` sorts the rays into depend on where the rays go,
+	/// so they are not reserved and grow over the first casts instead.
+	void reserve(std::size_t ray_count);
+
+	/// Queues the ray p1 -> p2, whose result will be written back to the ray `ray` of the car at index `car`.
+	void add(std::uint32_t car, std::uint32_t ray, b2Vec2 p1, b2Vec2 p2);
+
+	/// Casts all the queued rays and writes the closest fractions back to the state table of their cars.
+	void cast(const WallGrid& grid, CarStateTable& state);
+
+	std::size_t size() const { return _origin_x.size(); }
+
+	private:
+	std::vector<float> _origin_x, _origin_y;
+	std::vector<float> _delta_x, _delta_y; ///< direction scaled by the ray radius
+	std::vector<float> _fractions;
+
+	std::vector<std::uint32_t> _cars;
+	std::vector<std::uint32_t> _rays;
+
+	/// Cell of the grid in the high half, index of a ray going through it in the low half, sorted by cell
+	std::vector<std::uint64_t> _cell_rays;
+
+	/// Rays of the cell being tested, gathered contiguously
+	std::vector<float> _lane_origin_x, _lane_origin_y;
+	std::vector<float> _lane_delta_x, _lane_delta_y;
+	std::vector<float> _lane_closest;
+};
+} // namespace sim
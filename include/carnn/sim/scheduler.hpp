@@ -0,0 +1,76 @@
+#pragma once
+
+#include <carnn/sim/fwd.hpp>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace sim
+{
+/// The stages of a unit tick, in the order they run. Each only touches the unit it is given, and `act` ends the tick.
+struct TickStages
+{
+	std::function<void(SimulationUnit&)> sense; ///< reading the car states and casting the rays
+	std::function<void(SimulationUnit&)> infer; ///< running the networks
+	std::function<void(SimulationUnit&)> act;   ///< applying the controls, stepping the world and advancing the clock
+};
+
+/// Spreads the ticking of the units of a simulation over the TBB workers, following `SimulationSettings::tick_pipeline`.
+///
+/// A unit's world can only be stepped by one thread at a time, so units are the smallest piece of work there is.
+/// Since cars die at different rates in different units, units are weighted by their live car count and handed out
+/// heaviest first (longest processing time first), so that the units with the most survivors start early instead of
+/// being left for last while the other workers idle.
+///
+/// With TickPipeline::PerUnit, a worker runs whole ticks of a unit, one after the other.
+///
+/// With TickPipeline::Staged, units are dealt into groups, and the stages of a tick form a TBB flow graph that each
+/// group goes around once per tick: all the units of the group sense, then all of them infer, then all of them act.
+/// A stage thus streams through the same kind of data for several units in a row, and different groups are in
+/// different stages at the same time. The graph of each NUMA node is built once, in the arena of the node, and only
+/// fed the groups on every `advance`.
+class Scheduler
+{
+	public:
+	Scheduler();
+	~Scheduler();
+
+	Scheduler(const Scheduler&) = delete;
+	Scheduler& operator=(const Scheduler&) = delete;
+
+	/// Runs up to `ticks` ticks of every unit, not ticking units past `max_seconds`.
+	/// Units without any live car only have their clock advanced. Units are only ever ticked from the threads of
+	/// the NUMA node the placement of the simulation puts them on.
+	void advance(Simulation& sim, std::size_t ticks, float max_seconds, const TickStages& stages);
+
+	/// Relative cost of ticking a unit: its living cars, plus stepping the world itself
+	static std::size_t estimated_cost(const SimulationUnit& unit);
+
+	private:
+	/// What the stages of the staged pipeline need to know about a batch, carried along with the groups
+	struct UnitGroup
+	{
+		std::vector<SimulationUnit*> units;
+		std::size_t                  ticks = 0; ///< done during the current `advance`
+
+		std::size_t       batch_ticks = 0;
+		float             max_seconds = 0.0f;
+		const TickStages* stages      = nullptr;
+	};
+
+	class Pipeline;
+
+	void advance_per_unit(std::size_t node, std::size_t ticks, float max_seconds, const TickStages& stages);
+	void advance_staged(std::size_t node);
+
+	/// Units to tick, per NUMA node, heaviest first
+	std::vector<std::vector<SimulationUnit*>> _queues;
+
+	/// Groups of the staged pipeline, per NUMA node
+	std::vector<std::vector<UnitGroup>> _groups;
+
+	/// Flow graphs of the staged pipeline, per NUMA node, built on first use
+	std::vector<std::unique_ptr<Pipeline>> _pipelines;
+};
+} // namespace sim
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cereal/cereal.hpp>
+#include <cstdint>
+
+namespace sim
+{
+enum class RaycastMethod : std::uint8_t
+{
+	Exact,         ///< one Box2D ray cast per ray against the wall fixtures
+	DistanceField, ///< sphere tracing against the map's precomputed distance field, see DistanceField::max_error()
+	Batched,       ///< all the rays of a unit cast at once against a WallGrid, checked against Exact by CarNN-raycheck
+
+	Total
+};
+
+enum class RaySchedule : std::uint8_t
+{
+	EveryTick,  ///< every ray of every car, every tick
+	RoundRobin, ///< ray `r` on the ticks where `(r + tick) % ray_period == 0`
+	Adaptive,   ///< like RoundRobin, the period shrinking down to every tick as the car speeds up
+
+	Total
+};
+
+enum class VehicleModel : std::uint8_t
+{
+	Wheeled,    ///< a chassis and four wheel bodies held by revolute joints, each wheel applying its own tire forces
+	SingleBody, ///< the chassis alone, carrying the wheels' mass and applying their tire forces at the wheel anchors
+	Kinematic,  ///< the single body model integrated by CarKinematics outside of Box2D, walls only kill on contact
+
+	Total
+};
+
+enum class TickPipeline : std::uint8_t
+{
+	PerUnit, ///< each worker runs whole ticks of a unit
+	Staged,  ///< groups of units go through a flow graph of the tick stages, see Scheduler
+
+	Total
+};
+
+struct SimulationSettings
+{
+	RaycastMethod raycast_method = RaycastMethod::Exact;
+
+	/// Rays of the lidar of each car, which also sets the size of the networks. Only applies to new epochs, where a
+	/// new population gets generated if the count changed.
+	std::int32_t ray_count = 3;
+
+	RaySchedule  ray_schedule = RaySchedule::RoundRobin;
+	std::int32_t ray_period   = 2; ///< ticks between two casts of a ray, for RoundRobin and Adaptive schedules
+
+	VehicleModel vehicle_model = VehicleModel::Wheeled;
+
+	/// Physics ticks between two runs of the sensors and networks. Cars keep their controls in between.
+	std::int32_t control_period = 1;
+
+	TickPipeline tick_pipeline   = TickPipeline::PerUnit;
+	std::int32_t unit_group_size = 2; ///< units going through each stage together, for TickPipeline::Staged
+
+	/// Spacing, in world units, between two samples of the distance field. Should stay well below the car width.
+	float distance_field_resolution = 1.0f;
+
+	std::int32_t population_size = 4000;
+
+	/// How many units (i.e. independent worlds) to spread the population over, 0 to let the AutoTuner decide
+	std::int32_t unit_count = 0;
+
+	/// Threads ticking the simulation, 0 for one less than the core count so that the UI keeps a core to itself.
+	/// Only read at startup.
+	std::int32_t thread_count = 0;
+
+	/// Loads simulation.json, sanitized
+	bool load_from_file();
+	bool save();
+	void load_defaults();
+
+	/// Brings every field back within what the simulation handles, whether it came from a file or from the UI
+	void sanitize();
+
+	template<class Archive>
+	void serialize(Archive& ar)
+	{
+		ar(CEREAL_NVP(raycast_method),
+		   CEREAL_NVP(ray_count),
+		   CEREAL_NVP(ray_schedule),
+		   CEREAL_NVP(ray_period),
+		   CEREAL_NVP(vehicle_model),
+		   CEREAL_NVP(control_period),
+		   CEREAL_NVP(tick_pipeline),
+		   CEREAL_NVP(unit_group_size),
+		   CEREAL_NVP(distance_field_resolution),
+		   CEREAL_NVP(population_size),
+		   CEREAL_NVP(unit_count),
+		   CEREAL_NVP(thread_count));
+	}
+};
+} // namespace sim
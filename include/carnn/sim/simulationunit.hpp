@@ -1,8 +1,20 @@
 #pragma once
 
+#include <carnn/sim/carstatetable.hpp>
+#include <carnn/sim/distancefield.hpp>
+#include <carnn/sim/entities/checkpoint.hpp>
 #include <carnn/sim/entities/car.hpp>
 #include <carnn/sim/fwd.hpp>
+#include <carnn/sim/kinematics.hpp>
+#include <carnn/sim/map.hpp>
+#include <carnn/sim/placement.hpp>
+#include <carnn/sim/raybatch.hpp>
+#include <carnn/sim/settings.hpp>
+#include <carnn/sim/tickprofile.hpp>
+#include <carnn/sim/wallgrid.hpp>
 #include <carnn/sim/world.hpp>
+#include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace sim
@@ -10,44 +22,136 @@ namespace sim
 class SimulationUnit
 {
 	public:
+	/// Whether the controllers run this tick, see SimulationSettings::control_period
+	bool control_due() const { return ticks_elapsed % control_period == 0; }
+
+	/// Copies the kinematics of the live cars into `state`, before the controllers run
+	void gather_state()
+	{
+		if (vehicle_model == VehicleModel::Kinematic)
+		{
+			state.gather(cars, kinematics, live_cars);
+		}
+		else
+		{
+			state.gather(cars, live_cars);
+		}
+	}
+
+	/// Computes the objective and ray directions of the living cars, see CarStateTable::sense
+	void sense() { state.sense(live_cars); }
+
+	/// Updates the lidar of all the living cars of this unit, from and into `state`
+	void compute_raycasts();
+
+	/// Applies the controls in `state` to the live cars, before stepping the world, on every tick so that controls hold
+	/// between two runs of the controllers. Kinematic cars read them straight from `state`.
+	void scatter_controls()
+	{
+		if (vehicle_model != VehicleModel::Kinematic)
+		{
+			state.scatter(cars, live_cars);
+		}
+	}
+
+	/// Moves the cars by `seconds` and updates them, through Box2D or CarKinematics depending on `vehicle_model`
+	void step(float seconds);
+
+	/// Removes a car from `live_cars`. Safe to call more than once per car.
+	void retire_car(std::uint32_t index);
+
+	/// Brings every car back into `live_cars`
+	void revive_cars();
+
+	std::size_t live_car_count() const { return live_cars.size(); }
+
+	/// Moves the unit clock forward by one tick
+	void advance_clock();
+
+	static constexpr float tick_seconds = 1.0f / 30.0f;
+
 	World world;
 
-	std::vector<entities::Car*>        cars;
-	std::vector<entities::Checkpoint*> checkpoints;
-	entities::Body*                    wall;
-	entities::CarCheckpointListener    contact_listener;
+	std::vector<entities::Car*> cars;
+
+	CarStateTable state;
+
+	/// Indices in `cars` of the cars still alive, in no particular order
+	std::vector<std::uint32_t> live_cars;
+
+	std::vector<entities::Checkpoint> checkpoints;
+	entities::Body*                   wall = nullptr;
+	entities::CarWallListener         contact_listener;
+
+	std::size_t   control_period = 1;
+	VehicleModel  vehicle_model  = VehicleModel::Wheeled;
+	CarKinematics kinematics;
+
+	RaycastMethod        raycast_method = RaycastMethod::Exact;
+	const DistanceField* distance_field = nullptr;
+	const WallGrid*      wall_grid      = nullptr;
+	RayBatch             ray_batch;
 
 	std::size_t ticks_elapsed   = 0;
 	float       seconds_elapsed = 0.0f;
-};
 
-struct MapSettings
-{
-	std::string map_path;
-	std::string checkpoint_path;
-	bool flip = false;
+	TickProfile profile;
+
+	private:
+	/// Position of each car in `live_cars`, or `dead_slot`
+	std::vector<std::uint32_t> _live_slots;
+
+	static constexpr std::uint32_t dead_slot = std::uint32_t(-1);
 };
 
 class Simulation
 {
 	public:
-	Simulation(MapSettings settings);
+	Simulation() = default;
 
-	void load_map();
-	void load_checkpoints();
-	void init_cars();
+	/// Builds the units from the threads of the NUMA node `placement` puts them on
+	Simulation(
+		MapSettings        settings,
+		SimulationSettings simulation_settings,
+		std::size_t        unit_count,
+		Placement&         placement);
 
-	SimulationUnit& optimal_unit();
+	/// Swaps the walls and checkpoints of every unit for the ones of another map, leaving the cars untouched.
+	/// Cars still point to the old checkpoints until the next `reset`.
+	void set_map(const MapSettings& settings);
 
-	MapSettings settings;
+	/// Puts every car back at the spawn point of the map in its initial state, applies `simulation_settings` and
+	/// rewinds the unit clocks. Cars and worlds are reused; the state tables and ray batches keep their capacity, so
+	/// they only allocate when the ray or car count grows.
+	void reset();
 
-	std::vector<SimulationUnit> units;
+	/// Puts each individual of `population` behind the wheel of its car, for the current run.
+	///
+	/// Networks are reallocated from the NUMA node of the unit of their car, so that inference reads local memory. That
+	/// only happens to networks that are not already on that node, see Individual::network_node.
+	void attach(std::vector<Individual>& population);
 
-	std::vector<sf::Vertex> wall_vertices;
-	b2Vec2                  car_origin;
+	std::size_t live_car_count() const;
 
-	sf::VertexArray checkpoint_vertices;
+	/// Profiles of all the units, summed up
+	TickProfile profile() const;
+
+	SimulationSettings simulation_settings;
+
+	Placement* placement = nullptr;
+
+	std::shared_ptr<const Map> map;
+
+	std::vector<SimulationUnit> units;
+
+	std::shared_ptr<const DistanceField> distance_field;
 
 	std::vector<entities::Car*> cars;
+
+	private:
+	void load_walls(SimulationUnit& unit);
+	void load_checkpoints(SimulationUnit& unit);
+	void unload_map(SimulationUnit& unit);
+	void init_cars(SimulationUnit& unit, std::size_t car_count);
 };
 } // namespace sim
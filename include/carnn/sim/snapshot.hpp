@@ -0,0 +1,53 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <box2d/box2d.h>
+#include <carnn/neural/network.hpp>
+#include <carnn/sim/entities/car.hpp>
+#include <carnn/sim/fwd.hpp>
+#include <carnn/sim/tickprofile.hpp>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace sim
+{
+/// What it takes to draw a car, copied out of the physics world
+struct CarSnapshot
+{
+	b2Transform                body;
+	std::array<b2Transform, 4> wheels;
+	std::vector<sf::Vertex>    rays;
+
+	bool dead               = false;
+	bool survivor_from_last = false;
+
+	void capture(entities::Car& car);
+};
+
+/// State of the simulation as shown by the UI, published by the simulation thread after every batch of ticks
+struct Snapshot
+{
+	std::shared_ptr<const Map> map;
+
+	/// Best cars first, the first one being the tracked one
+	std::vector<CarSnapshot> cars;
+
+	/// Network of the tracked car, only captured when the UI asks for it
+	neural::Network tracked_network;
+	bool            has_tracked_network = false;
+
+	std::size_t car_count      = 0;
+	std::size_t live_car_count = 0;
+
+	std::size_t ticks_elapsed   = 0;
+	float       seconds_elapsed = 0.0f;
+
+	float       ups              = 0.0f;
+	std::size_t fast_batch_ticks = 0;
+
+	/// Summed over the units, since the start of the run
+	TickProfile profile;
+};
+} // namespace sim
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <carnn/util/allocationaudit.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace sim
+{
+enum class TickPhase : std::uint8_t
+{
+	Gather,  ///< reading the car states out of the physics
+	Sense,   ///< computing the objective and ray directions
+	Raycast, ///< casting the lidar rays
+	Infer,   ///< running the networks
+	Act,     ///< handing the controls to the physics
+	Physics, ///< stepping the cars and updating their race progress
+
+	Total
+};
+
+/// Where the ticks of a unit spent their time. Each unit keeps its own, so that timing costs no synchronization; the UI
+/// sums them up.
+struct TickProfile
+{
+	static constexpr std::size_t phase_count = std::size_t(TickPhase::Total);
+
+	std::array<std::chrono::nanoseconds, phase_count> time{};
+
+	/// Heap allocations per phase, only counted with util::allocation_audit
+	std::array<std::size_t, phase_count> allocations{};
+
+	std::size_t ticks         = 0;
+	std::size_t control_ticks = 0; ///< ticks that ran the sensors and networks
+	std::size_t rays_cast     = 0;
+	std::size_t inferences    = 0;
+
+	std::chrono::nanoseconds& operator[](const TickPhase phase) { return time[std::size_t(phase)]; }
+	std::chrono::nanoseconds  operator[](const TickPhase phase) const { return time[std::size_t(phase)]; }
+
+	TickProfile& operator+=(const TickProfile& other)
+	{
+		for (std::size_t i = 0; i < phase_count; ++i)
+		{
+			time[i] += other.time[i];
+			allocations[i] += other.allocations[i];
+		}
+
+		ticks += other.ticks;
+		control_ticks += other.control_ticks;
+		rays_cast += other.rays_cast;
+		inferences += other.inferences;
+		return *this;
+	}
+
+	static const char* phase_name(const TickPhase phase)
+	{
+		switch (phase)
+		{
+		case TickPhase::Gather: return "gather";
+		case TickPhase::Sense: return "sense";
+		case TickPhase::Raycast: return "raycast";
+		case TickPhase::Infer: return "infer";
+		case TickPhase::Act: return "act";
+		case TickPhase::Physics: return "physics";
+		case TickPhase::Total:
+		default: return "?";
+		}
+	}
+};
+
+/// Adds the time until it goes out of scope, and the allocations made by the calling thread meanwhile, to a phase of a
+/// profile
+class ScopedPhase
+{
+	public:
+	ScopedPhase(TickProfile& profile, const TickPhase phase) :
+		_time(profile[phase]),
+		_allocations(profile.allocations[std::size_t(phase)]),
+		_start(std::chrono::steady_clock::now()),
+		_start_allocations(util::thread_allocation_count())
+	{
+	}
+
+	ScopedPhase(const ScopedPhase&) = delete;
+	ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+	~ScopedPhase()
+	{
+		_time += std::chrono::steady_clock::now() - _start;
+		_allocations += util::thread_allocation_count() - _start_allocations;
+	}
+
+	private:
+	std::chrono::nanoseconds&             _time;
+	std::size_t&                          _allocations;
+	std::chrono::steady_clock::time_point _start;
+	std::size_t                           _start_allocations;
+};
+} // namespace sim
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cereal/cereal.hpp>
+#include <cereal/types/vector.hpp>
+#include <cstddef>
+#include <vector>
+
+namespace sim
+{
+struct NumaNode
+{
+	/// Logical CPUs of the node that this process is allowed to run on
+	std::vector<int> cpus;
+
+	template<class Archive>
+	void serialize(Archive& ar)
+	{
+		ar(CEREAL_NVP(cpus));
+	}
+};
+
+/// What the machine we run on looks like, as far as sizing the simulation goes
+struct Topology
+{
+	std::size_t core_count    = 1;
+	std::size_t l2_cache_size = 256 * 1024;      ///< per core, in bytes
+	std::size_t l3_cache_size = 8 * 1024 * 1024; ///< in bytes
+
+	/// Never empty after `detect`. A single node means there is nothing to gain from NUMA-aware placement.
+	std::vector<NumaNode> nodes;
+
+	/// Probes the machine, unless a topology.json file overrides it (e.g. to fake several NUMA nodes)
+	static Topology detect();
+
+	bool load_from_file();
+
+	template<class Archive>
+	void serialize(Archive& ar)
+	{
+		ar(CEREAL_NVP(core_count), CEREAL_NVP(l2_cache_size), CEREAL_NVP(l3_cache_size), CEREAL_NVP(nodes));
+	}
+};
+} // namespace sim
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <carnn/sim/fwd.hpp>
+#include <memory>
+#include <vector>
+
+namespace sim
+{
+/// Draws the walls and checkpoints of a map, which never change during a run.
+///
+/// The lines are split into square tiles, each uploaded once into a static vertex buffer (or kept in a vertex array
+/// where vertex buffers are unavailable). Only the tiles intersecting the current view get drawn, so zooming in on a
+/// large map draws a small part of it.
+class TrackRenderer
+{
+	public:
+	/// Rebuilds the tiles for another map, does nothing if it is already the current one. Needs the GL context.
+	void set_map(std::shared_ptr<const Map> map);
+
+	const std::shared_ptr<const Map>& map() const { return _map; }
+
+	void draw(sf::RenderTarget& target) const;
+
+	/// Tiles drawn by the last `draw`, out of `tile_count()`
+	std::size_t drawn_tile_count() const { return _drawn_tile_count; }
+	std::size_t tile_count() const { return _tiles.size(); }
+
+	private:
+	struct Tile
+	{
+		/// Bounds of the lines of the tile, which may stick out of the tile itself
+		sf::FloatRect bounds;
+
+		std::vector<sf::Vertex> vertices;
+		sf::VertexBuffer        buffer{sf::Lines, sf::VertexBuffer::Static};
+	};
+
+	/// Tiles along the longest side of the map
+	static constexpr float tiles_per_side = 16.0f;
+
+	std::shared_ptr<const Map> _map;
+
+	std::vector<std::unique_ptr<Tile>> _tiles;
+	bool                               _use_buffers = false;
+
+	mutable std::size_t _drawn_tile_count = 0;
+};
+} // namespace sim
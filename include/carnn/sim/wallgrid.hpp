@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <box2d/box2d.h>
+#include <carnn/util/line.hpp>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace sim
+{
+/// Rays as structure of arrays, each `delta` being the direction of its ray scaled by the ray length
+struct RayLanes
+{
+	const float* origin_x;
+	const float* origin_y;
+	const float* delta_x;
+	const float* delta_y;
+
+	/// Closest hit of each ray so far, as a fraction of its `delta`
+	float* closest;
+
+	std::size_t count;
+};
+
+/// Wall segments of a map bucketed in a uniform grid. The segments overlapping each cell are stored contiguously, as
+/// structure of arrays, so that testing a ray against a cell is a straight loop over a few floats.
+///
+/// Intersections are computed the same way as b2EdgeShape::RayCast does for two-sided edges, so that results only
+/// differ from Box2D ray casts against the wall fixtures by float rounding, which CarNN-raycheck checks.
+class WallGrid
+{
+	public:
+	WallGrid(const std::vector<util::Line>& walls, float cell_size = 8.0f);
+
+	/// Returns the fraction of `delta` at which the ray starting from `origin` first hits a wall, or 1 if it hits none.
+	float raycast(b2Vec2 origin, b2Vec2 delta) const;
+
+	/// Calls `func(cell, t_exit)` for every cell the ray starting from `origin` goes through, in order, `t_exit` being
+	/// the fraction of `delta` at which the ray leaves the cell. Stops early when `func` returns false.
+	template<class Func>
+	void walk(b2Vec2 origin, b2Vec2 delta, Func&& func) const;
+
+	std::size_t segment_count(std::size_t cell) const { return _cell_begin[cell + 1] - _cell_begin[cell]; }
+
+	/// Lowers the `closest` fraction of every ray of `rays` that hits a segment of `cell` before it. Each segment is
+	/// tested against all the rays at once, the rays being the vector lanes.
+	void closest_in_cell(std::size_t cell, const RayLanes& rays) const;
+
+	private:
+	float closest_in_cell(std::size_t cell, b2Vec2 origin, b2Vec2 delta, float closest) const;
+
+	b2Vec2      _origin;
+	float       _cell_size;
+	std::size_t _width = 0, _height = 0;
+
+	/// Segments of cell `i` are in the range [_cell_begin[i]; _cell_begin[i + 1]) of the arrays below
+	std::vector<std::uint32_t> _cell_begin;
+
+	std::vector<float> _v1_x, _v1_y;         ///< first vertex
+	std::vector<float> _edge_x, _edge_y;     ///< second vertex minus first vertex
+	std::vector<float> _edge_length_squared;
+	std::vector<float> _normal_x, _normal_y; ///< normalized right-hand normal of the edge
+};
+
+template<class Func>
+void WallGrid::walk(const b2Vec2 origin, const b2Vec2 delta, Func&& func) const
+{
+	// move to grid space, where cells are 1x1 and the grid starts at the origin
+	const b2Vec2 start = (1.0f / _cell_size) * (origin - _origin);
+	const b2Vec2 step  = (1.0f / _cell_size) * delta;
+
+	// clip the ray against the grid bounds
+	float t_enter = 0.0f, t_leave = 1.0f;
+
+	const auto clip = [&](const float p, const float d, const float size) {
+		if (d == 0.0f)
+		{
+			return p >= 0.0f && p < size;
+		}
+
+		const float t0 = (0.0f - p) / d, t1 = (size - p) / d;
+		t_enter        = std::max(t_enter, std::min(t0, t1));
+		t_leave        = std::min(t_leave, std::max(t0, t1));
+		return true;
+	};
+
+	if (!clip(start.x, step.x, float(_width)) || !clip(start.y, step.y, float(_height)) || t_enter > t_leave)
+	{
+		return;
+	}
+
+	// walk the cells along the ray (Amanatides & Woo)
+	const b2Vec2 entry = start + t_enter * step;
+
+	long x = std::clamp(long(std::floor(entry.x)), 0l, long(_width) - 1);
+	long y = std::clamp(long(std::floor(entry.y)), 0l, long(_height) - 1);
+
+	const long step_x = step.x > 0.0f ? 1 : -1;
+	const long step_y = step.y > 0.0f ? 1 : -1;
+
+	const float infinity     = std::numeric_limits<float>::infinity();
+	const float t_delta_x    = step.x != 0.0f ? std::abs(1.0f / step.x) : infinity;
+	const float t_delta_y    = step.y != 0.0f ? std::abs(1.0f / step.y) : infinity;
+	float       t_boundary_x = step.x != 0.0f ? (float(x + (step_x > 0 ? 1 : 0)) - start.x) / step.x : infinity;
+	float       t_boundary_y = step.y != 0.0f ? (float(y + (step_y > 0 ? 1 : 0)) - start.y) / step.y : infinity;
+
+	for (;;)
+	{
+		const float t_cell_exit = std::min(t_boundary_x, t_boundary_y);
+
+		if (!func(std::size_t(y) * _width + std::size_t(x), t_cell_exit) || t_cell_exit >= t_leave)
+		{
+			break;
+		}
+
+		if (t_boundary_x < t_boundary_y)
+		{
+			x += step_x;
+			t_boundary_x += t_delta_x;
+		}
+		else
+		{
+			y += step_y;
+			t_boundary_y += t_delta_y;
+		}
+
+		if (x < 0 || y < 0 || x >= long(_width) || y >= long(_height))
+		{
+			break;
+		}
+	}
+}
+} // namespace sim
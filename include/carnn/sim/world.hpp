@@ -5,6 +5,10 @@
 #include <vector>
 
 #include <carnn/sim/entities/body.hpp>
+#include <carnn/sim/entities/car.hpp>
+#include <carnn/sim/entities/wheel.hpp>
+#include <carnn/util/pool.hpp>
+#include <type_traits>
 
 namespace sim
 {
@@ -16,25 +20,70 @@ class World
 	World(const b2Vec2 gravity = b2Vec2{0, 0});
 
 	World& step(const float speed, const int vel_it, const int pos_it);
+
+	/// Updates the live cars, which update their own wheels
 	World& update();
-	World& render(sf::RenderTarget& target);
 
-	void update_view(sf::RenderTarget& target, sf::Vector2f origin, float czoom);
+	static void update_view(sf::RenderTarget& target, sf::Vector2f origin, float czoom);
 
 	template<typename T = entities::Body>
 	T& add_body(const b2BodyDef bdef)
 	{
-		// Emplace a body and return
-		_bodies.emplace_back(std::make_unique<T>(*this, bdef));
-		return *static_cast<T*>(_bodies.back().get());
+		T& body = pool<T>().emplace(*this, bdef);
+
+		if constexpr (std::is_same_v<T, entities::Car>)
+		{
+			_active_cars.push_back(&body);
+		}
+
+		return body;
 	}
 
+	/// Takes a body out of the physics world (broadphase, contacts and joints included) and out of `update`.
+	/// Must not be called from within `step`.
+	void disable_body(entities::Body& body);
+
+	/// Brings a body disabled with `disable_body` back
+	void enable_body(entities::Body& body);
+
+	/// Destroys a body created with `add_body`, along with its fixtures and joints
+	void remove_body(entities::Body& body);
+
 	b2World& get();
 
-	std::size_t body_count() const { return _bodies.size(); }
+	std::size_t body_count() const
+	{
+		return _bodies.size() + _cars.size() + _wheels.size();
+	}
 
 	private:
-	std::vector<std::unique_ptr<entities::Body>> _bodies;
+	template<typename T>
+	util::Pool<T>& pool()
+	{
+		if constexpr (std::is_same_v<T, entities::Car>)
+		{
+			return _cars;
+		}
+		else if constexpr (std::is_same_v<T, entities::Wheel>)
+		{
+			return _wheels;
+		}
+		else
+		{
+			static_assert(std::is_same_v<T, entities::Body>, "no pool for this body type");
+			return _bodies;
+		}
+	}
+
+	// one pool per body type, so that each update pass walks contiguous objects of a single type
+	util::Pool<entities::Body>  _bodies;
+	util::Pool<entities::Car>   _cars;
+	util::Pool<entities::Wheel> _wheels;
+
+	/// Cars that `update` iterates over. Disabled cars are pruned at the end of `update`, so that cars may be
+	/// disabled while it runs.
+	std::vector<entities::Car*> _active_cars;
+	bool                        _prune_active_cars = false;
 
 	b2Vec2  _gravity;
 	b2World _world;
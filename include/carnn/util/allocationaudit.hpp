@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+
+namespace util
+{
+/// Whether heap allocations get counted, which takes building with CARNN_ALLOCATION_AUDIT.
+///
+/// The global operator new is then replaced by a counting one, and the allocations Box2D makes through b2Alloc are
+/// counted too. Counts are kept per thread, so that counting costs no synchronization and a piece of work running on
+/// a single thread can measure its own allocations.
+#ifdef CARNN_ALLOCATION_AUDIT
+constexpr bool allocation_audit = true;
+
+/// Heap allocations made by the calling thread so far
+std::size_t thread_allocation_count();
+#else
+constexpr bool allocation_audit = false;
+
+inline std::size_t thread_allocation_count() { return 0; }
+#endif
+} // namespace util
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <array>
+#include <carnn/util/maths.hpp>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+
+namespace util
+{
+/// Cosine and sine of fractions of a half turn, sampled finely enough that interpolating them linearly stays within
+/// 2e-6 of the exact values. Lookups do not branch, so that loops using them stay vectorizable.
+class HalfTurnTable
+{
+	public:
+	HalfTurnTable()
+	{
+		for (int i = 0; i <= steps; ++i)
+		{
+			_cos[i] = std::cos(float(M_PI) * float(i) / float(steps));
+			_sin[i] = std::sin(float(M_PI) * float(i) / float(steps));
+		}
+	}
+
+	/// Cosine and sine of `fraction` (0..1) half turns
+	std::pair<float, float> operator()(const float fraction) const
+	{
+		// int rather than size_t, whose conversion from float keeps GCC from vectorizing
+		const float x = clamp(fraction, 0.0f, 1.0f) * float(steps);
+		const int   i = clamp(int(x), 0, steps - 1);
+		const float t = x - float(i);
+
+		return {_cos[i] + t * (_cos[i + 1] - _cos[i]), _sin[i] + t * (_sin[i + 1] - _sin[i])};
+	}
+
+	/// Cosine and sine of an angle within a half turn either way, in radians
+	std::pair<float, float> rotation(const float radians) const
+	{
+		const auto [c, s] = (*this)(std::abs(radians) * float(M_1_PI));
+		return {c, std::copysign(s, radians)};
+	}
+
+	private:
+	static constexpr int steps = 1024;
+
+	std::array<float, steps + 1> _cos, _sin;
+};
+
+inline const HalfTurnTable half_turn;
+} // namespace util
@@ -11,5 +11,23 @@ struct Line
 	bool strictly_equal(const Line& other) const { return p1 == other.p1 && p2 == other.p2; }
 
 	bool operator==(const Line& other) const { return strictly_equal(other) || strictly_equal({other.p2, other.p1}); }
+
+	/// Whether the two segments have a point in common. Parallel segments never do.
+	bool intersects(const Line& other) const
+	{
+		const sf::Vector2f a = p2 - p1, b = other.p2 - other.p1, d = other.p1 - p1;
+
+		const float denominator = a.x * b.y - a.y * b.x;
+
+		if (denominator == 0.0f)
+		{
+			return false;
+		}
+
+		const float t = (d.x * b.y - d.y * b.x) / denominator;
+		const float u = (d.x * a.y - d.y * a.x) / denominator;
+
+		return t >= 0.0f && t <= 1.0f && u >= 0.0f && u <= 1.0f;
+	}
 };
 } // namespace util
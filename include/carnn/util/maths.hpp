@@ -6,10 +6,11 @@
 
 namespace util
 {
+/// Selects by value rather than through references as std::min and std::max do, which lets loops calling it vectorize
 template<class T>
 T clamp(T x, T lower, T upper)
 {
-	return std::min(upper, std::max(lower, x));
+	return x < lower ? lower : (upper < x ? upper : x);
 }
 
 template<class T>
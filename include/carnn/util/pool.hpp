@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace util
+{
+/// Stores objects of a single type contiguously, in fixed-size chunks that never move once allocated.
+///
+/// Objects keep their address for their whole lifetime, so they may be neither copyable nor movable. Erased slots are
+/// reused by the next `emplace`, and a pool emptied by `erase` starts filling from its first chunk again.
+template<class T, std::size_t ChunkSize = 64>
+class Pool
+{
+	public:
+	Pool() = default;
+
+	Pool(const Pool&) = delete;
+	Pool& operator=(const Pool&) = delete;
+
+	~Pool() { clear(); }
+
+	template<class... Args>
+	T& emplace(Args&&... args)
+	{
+		std::size_t slot;
+
+		if (!_free.empty())
+		{
+			slot = _free.back();
+			_free.pop_back();
+		}
+		else
+		{
+			slot = _live.size();
+
+			if (slot / ChunkSize == _chunks.size())
+			{
+				_chunks.push_back(std::make_unique<Chunk>());
+			}
+
+			_live.push_back(false);
+		}
+
+		T* item;
+
+		try
+		{
+			item = new (address(slot)) T(std::forward<Args>(args)...);
+		}
+		catch (...)
+		{
+			_free.push_back(slot);
+			throw;
+		}
+
+		_live[slot] = true;
+		++_size;
+		return *item;
+	}
+
+	/// Destroys an object created by `emplace`
+	void erase(T& item)
+	{
+		const std::size_t slot = slot_of(item);
+		assert(slot < _live.size() && _live[slot] && address(slot) == &item && "erasing an object not in this pool");
+
+		item.~T();
+		_live[slot] = false;
+		--_size;
+
+		if (_size == 0)
+		{
+			_free.clear();
+			_live.clear();
+		}
+		else
+		{
+			_free.push_back(slot);
+		}
+	}
+
+	/// Destroys all the objects, but keeps the chunks around for reuse
+	void clear()
+	{
+		for_each([](T& item) { item.~T(); });
+
+		_free.clear();
+		_live.clear();
+		_size = 0;
+	}
+
+	/// Calls `f` on every object, in slot order
+	template<class F>
+	void for_each(F&& f)
+	{
+		for (std::size_t slot = 0; slot < _live.size(); ++slot)
+		{
+			if (_live[slot])
+			{
+				f(*address(slot));
+			}
+		}
+	}
+
+	std::size_t size() const { return _size; }
+
+	private:
+	struct Chunk
+	{
+		alignas(T) std::byte storage[sizeof(T) * ChunkSize];
+	};
+
+	T* address(const std::size_t slot)
+	{
+		return std::launder(reinterpret_cast<T*>(_chunks[slot / ChunkSize]->storage + (slot % ChunkSize) * sizeof(T)));
+	}
+
+	std::size_t slot_of(const T& item) const
+	{
+		const auto* bytes = reinterpret_cast<const std::byte*>(&item);
+
+		for (std::size_t chunk = 0; chunk < _chunks.size(); ++chunk)
+		{
+			const std::byte* storage = _chunks[chunk]->storage;
+
+			if (bytes >= storage && bytes < storage + sizeof(Chunk::storage))
+			{
+				return chunk * ChunkSize + static_cast<std::size_t>(bytes - storage) / sizeof(T);
+			}
+		}
+
+		return _live.size();
+	}
+
+	std::vector<std::unique_ptr<Chunk>> _chunks;
+	std::vector<std::uint8_t>           _live;
+	std::vector<std::size_t>            _free;
+	std::size_t                         _size = 0;
+};
+} // namespace util
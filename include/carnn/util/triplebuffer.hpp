@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace util
+{
+/// Hands the latest of a stream of values from one producer thread to one consumer thread, without either of them
+/// ever waiting on the other.
+///
+/// The producer fills `back()` and `publish()`es it, the consumer calls `update()` and reads `front()`. The third
+/// buffer sits in between: publishing swaps it with the back buffer, updating swaps it with the front buffer if it
+/// holds something newer. Buffers are reused, so values holding allocations (e.g. vectors) stop allocating once they
+/// reached their working size.
+template<class T>
+class TripleBuffer
+{
+	public:
+	/// Producer side: the buffer to fill next
+	T& back() { return _buffers[_back]; }
+
+	/// Producer side: makes the back buffer the latest value, and gets a stale buffer as the new back buffer
+	void publish() { _back = _middle.exchange(_back | fresh_bit, std::memory_order_acq_rel) & index_mask; }
+
+	/// Consumer side: switches `front()` to the latest published value, if any. Returns whether it did.
+	bool update()
+	{
+		if ((_middle.load(std::memory_order_relaxed) & fresh_bit) == 0)
+		{
+			return false;
+		}
+
+		_front = _middle.exchange(_front, std::memory_order_acq_rel) & index_mask;
+		return true;
+	}
+
+	/// Consumer side: the latest value as of the last `update()`
+	const T& front() const { return _buffers[_front]; }
+
+	private:
+	static constexpr std::uint8_t index_mask = 0b011, fresh_bit = 0b100;
+
+	std::array<T, 3> _buffers{};
+
+	std::uint8_t              _back = 0, _front = 1;
+	std::atomic<std::uint8_t> _middle{2};
+};
+} // namespace util
@@ -1,23 +1,37 @@
 #include "imgui.h"
 #include <SFML/Graphics.hpp>
 #include <SFML/Window.hpp>
+#include <atomic>
 #include <carnn/neural/network.hpp>
 #include <carnn/neural/visualizer.hpp>
+#include <carnn/sim/autotuner.hpp>
+#include <carnn/sim/carrenderer.hpp>
 #include <carnn/sim/entities/car.hpp>
 #include <carnn/sim/entities/wheel.hpp>
 #include <carnn/sim/entities/checkpoint.hpp>
 #include <carnn/sim/individual.hpp>
+#include <carnn/sim/leaderboard.hpp>
+#include <carnn/sim/placement.hpp>
+#include <carnn/sim/scheduler.hpp>
+#include <carnn/sim/settings.hpp>
 #include <carnn/sim/simulationunit.hpp>
+#include <carnn/sim/snapshot.hpp>
+#include <carnn/sim/trackrenderer.hpp>
 #include <carnn/sim/world.hpp>
 #include <carnn/training/mutator.hpp>
 #include <cereal/archives/binary.hpp>
 #include <cereal/types/vector.hpp>
+#include <carnn/util/allocationaudit.hpp>
 #include <carnn/util/maths.hpp>
+#include <carnn/util/triplebuffer.hpp>
+#include <chrono>
 #include <fmt/core.h>
 #include <fstream>
 #include <imgui-SFML.h>
+#include <mutex>
 #include <spdlog/spdlog.h>
 #include <tbb/tbb.h>
+#include <thread>
 
 struct GuiWindows
 {
@@ -55,16 +69,41 @@ class App
 	private:
 	static sf::ContextSettings default_context_settings();
 
+	/// Runs on the simulation thread until `_quit` is set
+	void simulation_loop();
+
+	/// Handles the requests the UI made since the last batch, from the simulation thread
+	void process_commands();
+
 	void advance_simulation(std::size_t ticks = 1);
+
+	/// Runs a batch of ticks sized to take about `budget_seconds`, based on how long the previous batches took
+	void advance_simulation_sliced(float budget_seconds);
+
+	/// Copies what the UI shows of the simulation into the back snapshot and publishes it
+	void publish_snapshot();
+
 	void frame();
+	void draw_snapshot(const Snapshot& snapshot);
 
-	void tick(Individual& individual);
-	void tick(SimulationUnit& unit);
+	void tick(SimulationUnit& unit, std::uint32_t car_index);
+
+	/// Stages of a unit tick, see TickStages. Sensing and inference only happen on the ticks the controllers run.
+	void sense(SimulationUnit& unit);
+	void infer(SimulationUnit& unit);
+	void act(SimulationUnit& unit);
+
+	TickStages tick_stages();
 
 	void start_new_run(bool new_epoch);
 	void mutate_and_restart();
 
-	void reset_individuals();
+	void reset_individuals(const SimulationSettings& settings);
+
+	/// Replaces the population and mutator with the ones saved to `path`, and the ray count with the one of the loaded
+	/// networks. Leaves everything untouched and returns false when the file does not fit the cars of `_sim`.
+	bool load_networks(const char* path);
+
 	void load_fonts();
 
 	std::vector<MapSettings> make_default_map_pool();
@@ -74,8 +113,32 @@ class App
 	std::vector<MapSettings> _map_pool;
 	int _current_map = 0;
 
+	/// Guards the settings the UI edits while the simulation thread may read them: `_sim_settings` and
+	/// `_mutator.settings`, along with anything else `_mutator` touches.
+	std::mutex _settings_mutex;
+
+	SimulationSettings _sim_settings;
+
+	Topology                   _topology;
+	std::unique_ptr<Placement> _placement;
+	TuningResult    _tuning;
 	Simulation      _sim;
-	SimulationState _simulation_state = SimulationState::Realtime;
+	Scheduler       _scheduler;
+
+	std::thread                  _sim_thread;
+	std::atomic<SimulationState> _simulation_state{SimulationState::Realtime};
+	std::atomic<bool>            _quit{false};
+
+	// requests from the UI, handled by the simulation thread between two batches
+	std::atomic<bool> _mutate_requested{false}, _restart_requested{false};
+	std::atomic<bool> _save_requested{false}, _load_requested{false};
+
+	/// Whether the UI shows the network of the tracked car, so that snapshots need a copy of it
+	std::atomic<bool> _capture_network{false};
+
+	util::TripleBuffer<Snapshot> _snapshots;
+
+	Leaderboard _leaderboard{rendered_car_count};
 
 	std::vector<Individual> _population;
 	Mutator                 _mutator;
@@ -84,11 +147,27 @@ class App
 
 	sf::Font _font;
 
+	Visualizer _visualizer;
+
+	CarRenderer   _car_renderer;
+	TrackRenderer _track_renderer;
+
 	sf::Clock _frame_dt_clock;
 	sf::Clock _sim_dt_clock;
 
 	float _ups = 0.0f;
 
+	/// Time between two snapshots in fast mode
+	static constexpr float fast_batch_budget = 1.0f / 50.0f;
+
+	/// Pace of the realtime mode, which used to be one tick per frame at the 80 fps frame limit
+	static constexpr float realtime_ticks_per_second = 80.0f;
+
+	/// Cars drawn out of the population, best ones first
+	static constexpr std::size_t rendered_car_count = 100;
+
+	std::size_t _fast_batch_ticks = 10;
+
 	// TODO: move camera stuff elsewhere
 	float       _czoom              = 0.1f;
 	Individual* _tracked_individual = nullptr;
@@ -97,42 +176,129 @@ class App
 App::App() :
 	_window(sf::VideoMode(800, 600), "carnn", sf::Style::Default, default_context_settings()),
 	_map_pool(make_default_map_pool()),
-	_sim(_map_pool[0])
+	_topology(Topology::detect())
 {
 	ImGui::SFML::Init(_window, false);
 	load_fonts();
+	_sim_settings.load_from_file();
 	_mutator.settings.load_from_file();
-	reset_individuals();
+	reset_individuals(_sim_settings);
+
+	_placement = std::make_unique<Placement>(_topology, std::size_t(std::max(_sim_settings.thread_count, 0)));
+
+	_tuning = AutoTuner(_topology, *_placement)
+				  .tune(_map_pool[0], _sim_settings, _population, tick_stages());
+
+	_sim = {_map_pool[0], _sim_settings, _tuning.unit_count, *_placement};
 }
 
-App::~App() { ImGui::SFML::Shutdown(); }
+App::~App()
+{
+	_quit = true;
+
+	if (_sim_thread.joinable())
+	{
+		_sim_thread.join();
+	}
+
+	ImGui::SFML::Shutdown();
+}
 
 void App::run()
 {
-	_tracked_individual = &_population[0];
-
 	start_new_run(true);
+	publish_snapshot();
+
+	_sim_thread = std::thread([this] { simulation_loop(); });
 
 	while (_window.isOpen())
 	{
+		frame();
+	}
+
+	_quit = true;
+	_sim_thread.join();
+}
+
+void App::simulation_loop()
+{
+	using clock = std::chrono::steady_clock;
+
+	const auto realtime_period = std::chrono::duration_cast<clock::duration>(
+		std::chrono::duration<float>(1.0f / realtime_ticks_per_second));
+
+	auto next_tick = clock::now();
+
+	while (!_quit)
+	{
+		process_commands();
+
 		switch (_simulation_state)
 		{
 		case SimulationState::Realtime:
 		{
 			advance_simulation(1);
+			publish_snapshot();
+
+			// stay on schedule, unless we fell behind in which case catching up would only make it worse
+			next_tick = std::max(next_tick + realtime_period, clock::now());
+			std::this_thread::sleep_until(next_tick);
 			break;
 		}
 
 		case SimulationState::Fast:
 		{
-			advance_simulation(1000);
+			advance_simulation_sliced(fast_batch_budget);
+			publish_snapshot();
+			next_tick = clock::now();
+			break;
 		}
 
 		case SimulationState::Paused:
-		default: break;
+		default:
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			next_tick = clock::now();
+			break;
+		}
 		}
+	}
+}
 
-		frame();
+void App::process_commands()
+{
+	bool changed = false;
+
+	if (_save_requested.exchange(false))
+	{
+		std::lock_guard             lock(_settings_mutex);
+		std::ofstream               os("nets.bin", std::ios::binary);
+		cereal::BinaryOutputArchive archive(os);
+		archive(*this);
+	}
+
+	if (_load_requested.exchange(false) && load_networks("nets.bin"))
+	{
+		start_new_run(true);
+		changed = true;
+	}
+
+	if (_mutate_requested.exchange(false))
+	{
+		mutate_and_restart();
+		changed = true;
+	}
+
+	if (_restart_requested.exchange(false))
+	{
+		start_new_run(true);
+		changed = true;
+	}
+
+	// so that the UI sees the new run even while paused
+	if (changed)
+	{
+		publish_snapshot();
 	}
 }
 
@@ -145,21 +311,7 @@ sf::ContextSettings App::default_context_settings()
 
 void App::advance_simulation(std::size_t ticks)
 {
-	tbb::parallel_for(tbb::blocked_range(_sim.units.begin(), _sim.units.end()), [&](const auto& range) {
-		for (SimulationUnit& unit : range)
-		{
-			for (std::size_t i = 0; i < ticks; ++i)
-			{
-				tick(unit);
-
-				// HACK:
-				if (unit.seconds_elapsed > 60.0f * 5.0f)
-				{
-					break;
-				}
-			}
-		}
-	});
+	_scheduler.advance(_sim, ticks, 60.0f * 5.0f, tick_stages());
 
 	// FIXME: this loses precision
 	const float total_time = _sim.units[0].seconds_elapsed;
@@ -173,12 +325,62 @@ void App::advance_simulation(std::size_t ticks)
 	_ups                    = float(ticks) * 1.0f / sim_time.asSeconds();
 }
 
+void App::advance_simulation_sliced(const float budget_seconds)
+{
+	const sf::Clock clock;
+	advance_simulation(_fast_batch_ticks);
+	const float elapsed = std::max(clock.getElapsedTime().asSeconds(), 1.0e-6f);
+
+	// damped so that a single hiccup (e.g. a new run starting) does not throw the batch size off
+	const float scale = std::clamp(budget_seconds / elapsed, 0.5f, 2.0f);
+	_fast_batch_ticks = std::clamp<std::size_t>(std::size_t(float(_fast_batch_ticks) * scale), 1, 1000);
+}
+
+void App::publish_snapshot()
+{
+	Snapshot& snapshot = _snapshots.back();
+
+	_leaderboard.update(_sim.cars);
+	if (Car* best = _leaderboard.best(); best != nullptr)
+	{
+		_tracked_individual = best->individual;
+	}
+
+	const std::vector<Leaderboard::Entry>& leaders = _leaderboard.entries();
+
+	snapshot.cars.resize(leaders.size());
+	for (std::size_t i = 0; i < leaders.size(); ++i)
+	{
+		snapshot.cars[i].capture(*leaders[i].car);
+	}
+
+	snapshot.has_tracked_network = _capture_network && _tracked_individual != nullptr;
+	if (snapshot.has_tracked_network)
+	{
+		snapshot.tracked_network = _tracked_individual->network;
+	}
+
+	snapshot.map              = _sim.map;
+	snapshot.car_count        = _sim.cars.size();
+	snapshot.live_car_count   = _sim.live_car_count();
+	snapshot.ticks_elapsed    = _sim.units[0].ticks_elapsed;
+	snapshot.seconds_elapsed  = _sim.units[0].seconds_elapsed;
+	snapshot.ups              = _ups;
+	snapshot.fast_batch_ticks = _fast_batch_ticks;
+	snapshot.profile          = _sim.profile();
+
+	_snapshots.publish();
+}
+
 void App::frame()
 {
-	_window.setFramerateLimit(_simulation_state != SimulationState::Fast ? 80 : 0);
+	_window.setFramerateLimit(80);
 
 	const sf::Time frame_time = _frame_dt_clock.restart();
 
+	_snapshots.update();
+	const Snapshot& snapshot = _snapshots.front();
+
 	ImGui::SFML::Update(_window, frame_time);
 
 	for (sf::Event ev; _window.pollEvent(ev);)
@@ -210,17 +412,11 @@ void App::frame()
 			}
 			else if (ev.key.code == sf::Keyboard::S)
 			{
-				std::ofstream               os("nets.bin", std::ios::binary);
-				cereal::BinaryOutputArchive archive(os);
-				archive(*this);
+				_save_requested = true;
 			}
 			else if (ev.key.code == sf::Keyboard::L)
 			{
-				std::ifstream              is("nets.bin", std::ios::binary);
-				cereal::BinaryInputArchive archive(is);
-				archive(*this);
-
-				start_new_run(true);
+				_load_requested = true;
 			}
 			break;
 
@@ -235,91 +431,10 @@ void App::frame()
 	}
 
 	_window.clear(sf::Color{20, 20, 20});
-	_window.draw(_sim.checkpoint_vertices);
-	_window.draw(_sim.wall_vertices.data(), _sim.wall_vertices.size(), sf::Lines);
-
-	std::vector<Individual*> rendered_individuals(_population.size());
-	for (std::size_t i = 0; i < _population.size(); ++i)
-	{
-		Individual& individual = _population[i];
-		rendered_individuals[i] = &individual;
-
-		Car& c = *_sim.cars[individual.car_id];
-		if (!c.dead)
-		{
-			rendered_individuals.push_back(&individual);
-		}
-	}
-
-	tbb::parallel_sort(
-		rendered_individuals.begin(),
-		rendered_individuals.end(),
-		[&](const Individual* a, const Individual* b) {
-			// TODO: pls make a method for this jesus
-			Car& ac = *_sim.cars[a->car_id];
-			Car& bc = *_sim.cars[b->car_id];
-			return (ac.fitness() > bc.fitness());
-		}
-	);
-	_tracked_individual = rendered_individuals[0];
-
-	std::size_t rendered = 0;
-	for (auto it = rendered_individuals.begin(); it != rendered_individuals.end(); ++it)
-	{
-		//if (*it != _tracked_individual) continue;
-
-		Car& c = *_sim.cars[(*it)->car_id];
-
-		if (c.dead)
-		{
-			c.with_color(sf::Color{200, 0, 0, 60}, 255);
-		}
-
-		if ((*it)->survivor_from_last)
-		{
-			c.with_color(sf::Color{200, 50, 0, 200}, 255);
-		}
-		else
-		{
-			c.with_color(sf::Color{0, 0, 100, 40}, 255);
-		}
-
-		c.render(_window);
-
-		for (auto& wheel : c.get_wheels())
-		{
-			wheel->render(_window);
-		}
-
-		++rendered;
-
-		if (rendered >= 100)
-		{
-			break;
-		}
-	}
-
-	/*for (auto it = split_it; it != rendered_individuals.end(); ++it)
-	{
-		Car& c = *_sim.cars[(*it)->car_id];
-		c.fast_render(_window);
-	}*/
 
-	/*for (auto& unit : _sim.units)
+	if (snapshot.map != nullptr)
 	{
-		unit.world.render(_window);
-	}*/
-
-	if (_tracked_individual != nullptr)
-	{
-		Car& car = *_sim.cars[_tracked_individual->car_id];
-
-		const b2Vec2 b2target = car.get().GetPosition();
-		car.world().update_view(_window, sf::Vector2f{b2target.x, b2target.y}, _czoom);
-
-		/*sf::View view = _window.getView();
-		view.rotate(car.get().GetAngle() * (360.0f / (2.0f * 3.14159265359f)));
-		_window.setView(view);*/
+		draw_snapshot(snapshot);
 	}
 
 	sf::View world_view(_window.getView());
@@ -328,9 +443,10 @@ void App::frame()
 	_window.setView(sf::View{
 		sf::FloatRect{0.f, 0.f, float(_window.getSize().x) * ui_scale, float(_window.getSize().y) * ui_scale}});
 
-	if (_tracked_individual != nullptr && _gui.draw_neural)
+	_capture_network = _gui.draw_neural;
+	if (snapshot.has_tracked_network && _gui.draw_neural)
 	{
-		Visualizer(_tracked_individual->network).display(_window, _font);
+		_visualizer.display(_window, _font, snapshot.tracked_network);
 	}
 
 	if (ImGui::BeginMainMenuBar())
@@ -338,7 +454,7 @@ void App::frame()
 		ImGui::TextColored(
 			ImVec4(1.0, 1.0, 1.0, 0.5),
 			"%s",
-			fmt::format("CarNN - {:6.1f}fps - {:6.1f}ups", 1.0f / frame_time.asSeconds(), _ups).c_str());
+			fmt::format("CarNN - {:6.1f}fps - {:6.1f}ups", 1.0f / frame_time.asSeconds(), snapshot.ups).c_str());
 		ImGui::SameLine();
 
 		if (ImGui::BeginMenu("View"))
@@ -352,6 +468,8 @@ void App::frame()
 		ImGui::EndMainMenuBar();
 	}
 
+	std::unique_lock settings_lock(_settings_mutex);
+
 	if (_gui.simulation_open)
 	{
 		if (ImGui::Begin("Simulation", &_gui.simulation_open))
@@ -375,13 +493,186 @@ void App::frame()
 
 			if (ImGui::Button("Mutate current pop."))
 			{
-				mutate_and_restart();
+				_mutate_requested = true;
 			}
 
 			if (ImGui::Button("Restart current run"))
 			{
-				start_new_run(true);
+				_restart_requested = true;
 			}
+
+			ImGui::Text(
+				"%s", fmt::format("{} / {} cars alive", snapshot.live_car_count, snapshot.car_count).c_str());
+			ImGui::Text(
+				"%s",
+				fmt::format(
+					"{} units of {} cars ({})",
+					_tuning.unit_count,
+					_tuning.cars_per_unit,
+					_tuning.calibrated ? "auto-tuned" : "from settings")
+					.c_str());
+			ImGui::Text(
+				"%s",
+				fmt::format(
+					"{} simulation threads, {} ticks per fast batch",
+					_placement->thread_count(),
+					snapshot.fast_batch_ticks)
+					.c_str());
+			ImGui::Text(
+				"%s",
+				fmt::format(
+					"{} / {} track tiles drawn",
+					_track_renderer.drawn_tile_count(),
+					_track_renderer.tile_count())
+					.c_str());
+
+			ImGui::Separator();
+			ImGui::Text("Tick profile (since the start of the run)");
+
+			if (const TickProfile& profile = snapshot.profile; profile.ticks > 0)
+			{
+				for (std::size_t i = 0; i < TickProfile::phase_count; ++i)
+				{
+					const auto phase = TickPhase(i);
+					ImGui::Text(
+						"%s",
+						fmt::format(
+							"{:>8}: {:8.1f} us per unit tick",
+							TickProfile::phase_name(phase),
+							std::chrono::duration<float, std::micro>(profile[phase]).count() / float(profile.ticks))
+							.c_str());
+
+					if constexpr (util::allocation_audit)
+					{
+						ImGui::SameLine();
+						ImGui::Text(
+							"%s",
+							fmt::format(
+								", {:.3f} allocations ({} total)",
+								float(profile.allocations[i]) / float(profile.ticks),
+								profile.allocations[i])
+								.c_str());
+					}
+				}
+
+				ImGui::Text(
+					"%s",
+					fmt::format(
+						"controllers ran on {:.0f}% of ticks, {:.1f} inferences per unit tick",
+						100.0f * float(profile.control_ticks) / float(profile.ticks),
+						float(profile.inferences) / float(profile.ticks))
+						.c_str());
+
+				if (profile.rays_cast > 0)
+				{
+					ImGui::Text(
+						"%s",
+						fmt::format(
+							"{:.1f} rays per unit tick, {:.1f} ns of ray casting per ray",
+							float(profile.rays_cast) / float(profile.ticks),
+							std::chrono::duration<float, std::nano>(profile[TickPhase::Raycast]).count()
+								/ float(profile.rays_cast))
+							.c_str());
+				}
+			}
+
+			ImGui::Separator();
+			ImGui::Text("Lidar (applies on next run)");
+			ImGui::PushID("Lidar");
+
+			if (ImGui::RadioButton("Box2D", _sim_settings.raycast_method == RaycastMethod::Exact))
+			{
+				_sim_settings.raycast_method = RaycastMethod::Exact;
+			}
+
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Batched", _sim_settings.raycast_method == RaycastMethod::Batched))
+			{
+				_sim_settings.raycast_method = RaycastMethod::Batched;
+			}
+
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Distance field", _sim_settings.raycast_method == RaycastMethod::DistanceField))
+			{
+				_sim_settings.raycast_method = RaycastMethod::DistanceField;
+			}
+
+			ImGui::InputFloat("Field resolution", &_sim_settings.distance_field_resolution, 0.1, 0.5, "%.2f");
+
+			ImGui::InputInt("Rays (next epoch)", &_sim_settings.ray_count);
+
+			if (ImGui::RadioButton("Every tick", _sim_settings.ray_schedule == RaySchedule::EveryTick))
+			{
+				_sim_settings.ray_schedule = RaySchedule::EveryTick;
+			}
+
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Round-robin", _sim_settings.ray_schedule == RaySchedule::RoundRobin))
+			{
+				_sim_settings.ray_schedule = RaySchedule::RoundRobin;
+			}
+
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Adaptive", _sim_settings.ray_schedule == RaySchedule::Adaptive))
+			{
+				_sim_settings.ray_schedule = RaySchedule::Adaptive;
+			}
+
+			ImGui::InputInt("Ray period", &_sim_settings.ray_period);
+
+			ImGui::Separator();
+			ImGui::Text("Control (applies on next run)");
+
+			ImGui::InputInt("Control period", &_sim_settings.control_period);
+
+			ImGui::Separator();
+			ImGui::Text("Tick pipeline (applies on next run)");
+
+			if (ImGui::RadioButton("Per unit", _sim_settings.tick_pipeline == TickPipeline::PerUnit))
+			{
+				_sim_settings.tick_pipeline = TickPipeline::PerUnit;
+			}
+
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Staged", _sim_settings.tick_pipeline == TickPipeline::Staged))
+			{
+				_sim_settings.tick_pipeline = TickPipeline::Staged;
+			}
+
+			ImGui::InputInt("Units per group", &_sim_settings.unit_group_size);
+
+			ImGui::Separator();
+			ImGui::Text("Vehicle model (applies on next run)");
+
+			if (ImGui::RadioButton("Four wheels", _sim_settings.vehicle_model == VehicleModel::Wheeled))
+			{
+				_sim_settings.vehicle_model = VehicleModel::Wheeled;
+			}
+
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Single body", _sim_settings.vehicle_model == VehicleModel::SingleBody))
+			{
+				_sim_settings.vehicle_model = VehicleModel::SingleBody;
+			}
+
+			ImGui::SameLine();
+			if (ImGui::RadioButton("Kinematic", _sim_settings.vehicle_model == VehicleModel::Kinematic))
+			{
+				_sim_settings.vehicle_model = VehicleModel::Kinematic;
+			}
+
+			if (ImGui::Button("Load"))
+			{
+				_sim_settings.load_from_file();
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Save"))
+			{
+				_sim_settings.save();
+			}
+			ImGui::PopID();
+
+			_sim_settings.sanitize();
 		}
 		ImGui::End();
 	}
@@ -487,6 +778,8 @@ void App::frame()
 		ImGui::End();
 	}
 
+	settings_lock.unlock();
+
 	_window.setView(world_view);
 
 	ImGui::SFML::Render(_window);
@@ -494,93 +787,129 @@ void App::frame()
 	_window.display();
 }
 
-void App::tick(Individual& individual)
+void App::draw_snapshot(const Snapshot& snapshot)
 {
-	Car&     c   = *_sim.cars[individual.car_id];
-	Network& net = individual.network;
+	// the camera moves first so that the track is culled against the view it is drawn with
+	if (!snapshot.cars.empty())
+	{
+		const b2Vec2 b2target = snapshot.cars[0].body.p;
+		World::update_view(_window, sf::Vector2f{b2target.x, b2target.y}, _czoom);
+	}
+
+	_track_renderer.set_map(snapshot.map);
+	_track_renderer.draw(_window);
 
-	if (c.dead)
+	_car_renderer.clear();
+
+	for (const CarSnapshot& car : snapshot.cars)
 	{
-		return;
+		_car_renderer.add(car, car.survivor_from_last ? sf::Color{200, 50, 0, 200} : sf::Color{0, 0, 100, 40});
 	}
 
-	c.compute_raycasts();
+	_car_renderer.draw(_window);
+}
+
+void App::tick(SimulationUnit& unit, const std::uint32_t car_index)
+{
+	Network& net = *unit.state.network[car_index];
 
-	c.update_inputs(net);
+	unit.state.load_inputs(car_index, net);
 	net.update();
-	const auto& results = net.outputs();
+	unit.state.store_outputs(car_index, net);
+}
 
-	/*if (false)
+void App::sense(SimulationUnit& unit)
+{
+	if (!unit.control_due())
 	{
-		if (sf::Joystick::isConnected(0))
-		{
-			c.steer(sf::Joystick::getAxisPosition(0, sf::Joystick::X) / 100.0f);
-			c.accelerate(1.0f - (sf::Joystick::getAxisPosition(0, sf::Joystick::Y) / 200.0f + 0.5f)); //
-	wtf c.brake(1.0f - (sf::Joystick::getAxisPosition(0, sf::Joystick::Z) / 200.0f + 0.5f));      // wtf
-		}
+		return;
 	}
-	else if (false)
-	{
-		const bool forward = sf::Keyboard::isKeyPressed(sf::Keyboard::Z);
-		const bool left    = sf::Keyboard::isKeyPressed(sf::Keyboard::Q);
-		const bool right   = sf::Keyboard::isKeyPressed(sf::Keyboard::D);
-		const bool back    = sf::Keyboard::isKeyPressed(sf::Keyboard::S);
-		const bool brake   = sf::Keyboard::isKeyPressed(sf::Keyboard::C);
-		const bool drift   = sf::Keyboard::isKeyPressed(sf::Keyboard::Space);
 
-		if (forward ^ back)
-		{
-			c.accelerate(forward ? 1.0f : -1.0f);
-		}
-		else
-		{
-			c.accelerate(0.0f);
-		}
+	{
+		ScopedPhase phase{unit.profile, TickPhase::Gather};
+		unit.gather_state();
+	}
 
-		if (left ^ right)
-		{
-			c.steer(right ? 1.0f : -1.0f);
-		}
-		else
-		{
-			c.steer(0.0f);
-		}
+	{
+		ScopedPhase phase{unit.profile, TickPhase::Sense};
+		unit.sense();
+	}
 
-		c.brake(brake ? 1.0f : 0.0f);
+	{
+		ScopedPhase phase{unit.profile, TickPhase::Raycast};
+		unit.compute_raycasts();
+	}
+}
 
-		c.set_drift(drift ? 1.0f : 0.0f);
+void App::infer(SimulationUnit& unit)
+{
+	if (!unit.control_due())
+	{
+		return;
 	}
-	else*/
+
 	{
-		c.set_drift(static_cast<float>(results[Axon_Drift].value));
-		c.steer(static_cast<float>(results[Axon_Steer_Right].value - results[Axon_Steer_Left].value));
-		c.accelerate(static_cast<float>(results[Axon_Forward].value - results[Axon_Backwards].value));
-		c.brake(results[Axon_Brake].value);
-		for (std::size_t i = 0; i < total_rays; ++i)
+		ScopedPhase phase{unit.profile, TickPhase::Infer};
+
+		for (const std::uint32_t car_index : unit.live_cars)
 		{
-			c._ray_angles[i] = util::lerp(float(c._ray_angles[i]), std::clamp(results[Axon_FirstRay + i].value, 0.0f, 1.0f), 0.1f);
+			tick(unit, car_index);
 		}
+
+		unit.profile.inferences += unit.live_cars.size();
 	}
+
+	++unit.profile.control_ticks;
 }
 
-void App::tick(SimulationUnit& unit)
+void App::act(SimulationUnit& unit)
 {
-	for (auto& car : unit.cars)
 	{
-		tick(*car->individual);
+		ScopedPhase phase{unit.profile, TickPhase::Act};
+		unit.scatter_controls();
+	}
+
+	{
+		ScopedPhase phase{unit.profile, TickPhase::Physics};
+		unit.step(10.0f / 30.0f);
 	}
 
-	unit.world.step(10.0f / 30.0f, 1, 1).update();
-	++unit.ticks_elapsed;
-	unit.seconds_elapsed += 1.0f / 30.0f;
+	unit.advance_clock();
+}
+
+TickStages App::tick_stages()
+{
+	return {
+		[this](SimulationUnit& unit) { sense(unit); },
+		[this](SimulationUnit& unit) { infer(unit); },
+		[this](SimulationUnit& unit) { act(unit); }};
 }
 
 void App::start_new_run(bool new_epoch)
 {
+	std::unique_lock settings_lock(_settings_mutex);
+	SimulationSettings simulation_settings = _sim_settings;
+	settings_lock.unlock();
+
+	const std::size_t population_rays = _population.front().network.inputs().size() - 4;
+
+	if (!new_epoch)
+	{
+		// the networks of the epoch were built for this many rays
+		simulation_settings.ray_count = std::int32_t(population_rays);
+	}
+	else if (std::size_t(simulation_settings.ray_count) != population_rays)
+	{
+		spdlog::info("lidar now has {} rays, generating a new population", simulation_settings.ray_count);
+		reset_individuals(simulation_settings);
+	}
+
 	if (new_epoch)
 	{
 		_current_map = 0;
-		_sim = {_map_pool[0]};
+		_sim.simulation_settings = simulation_settings;
+		_sim.set_map(_map_pool[0]);
+		_sim.reset();
 	}
 	else
 	{
@@ -593,7 +922,9 @@ void App::start_new_run(bool new_epoch)
 			fitnesses[i] = _sim.cars[i]->fitness();
 		}
 
-		_sim = {_map_pool[_current_map]};
+		_sim.simulation_settings = simulation_settings;
+		_sim.set_map(_map_pool[_current_map]);
+		_sim.reset();
 
 		for (std::size_t i = 0; i < fitnesses.size(); ++i)
 		{
@@ -604,11 +935,7 @@ void App::start_new_run(bool new_epoch)
 
 	_tracked_individual = &_population[0];
 
-	for (auto& individual : _population)
-	{
-		individual.network.reset_values();
-		_sim.cars[individual.car_id]->individual = &individual;
-	}
+	_sim.attach(_population);
 }
 
 void App::mutate_and_restart()
@@ -621,15 +948,102 @@ void App::mutate_and_restart()
 	else
 	{
 		spdlog::info("mutating and beginning new epoch");
-		_mutator.darwin(_sim, _population);
+
+		{
+			std::lock_guard lock(_settings_mutex);
+			_mutator.darwin(_sim, _population);
+		}
+
 		start_new_run(true);
 	}
 }
 
-void App::reset_individuals()
+bool App::load_networks(const char* path)
 {
+	std::vector<Individual> population;
+	Mutator                 mutator;
+
+	try
+	{
+		std::ifstream              is(path, std::ios::binary);
+		cereal::BinaryInputArchive archive(is);
+		archive(population, mutator);
+	}
+	catch (const cereal::Exception& e)
+	{
+		spdlog::error("could not read {}: {}", path, e.what());
+		return false;
+	}
+
+	// the cars are only built once, so the saved population has to drive exactly those
+	if (population.size() != _sim.cars.size())
+	{
+		spdlog::error(
+			"{} holds {} individuals, the simulation has {} cars, not loading it",
+			path,
+			population.size(),
+			_sim.cars.size());
+		return false;
+	}
+
+	// every network reads the 4 car inputs then the rays, see reset_individuals
+	const std::size_t input_count = population.front().network.inputs().size();
+	const std::size_t ray_count   = input_count > 4 ? input_count - 4 : 0;
+
+	if (ray_count < 1 || ray_count > 64)
+	{
+		spdlog::error("{} holds networks with {} inputs, not loading it", path, input_count);
+		return false;
+	}
+
+	std::vector<bool> car_taken(_sim.cars.size(), false);
+
+	for (const Individual& individual : population)
+	{
+		if (individual.car_id >= car_taken.size() || car_taken[individual.car_id])
+		{
+			spdlog::error(
+				"{} puts an individual in car #{}, which is missing or taken, not loading it",
+				path,
+				individual.car_id);
+			return false;
+		}
+
+		car_taken[individual.car_id] = true;
+
+		if (individual.network.inputs().size() != input_count
+			|| individual.network.outputs().size() != ray_count + Axon_FirstRay)
+		{
+			spdlog::error("{} holds networks of different sizes, not loading it", path);
+			return false;
+		}
+	}
+
+	std::lock_guard lock(_settings_mutex);
+
+	_population = std::move(population);
+	_mutator    = std::move(mutator);
+
+	// start_new_run would otherwise throw the loaded networks away for a fresh population
+	_sim_settings.ray_count = std::int32_t(ray_count);
+
+	spdlog::info("loaded {} individuals with {} rays from {}", _population.size(), _sim_settings.ray_count, path);
+	return true;
+}
+
+void App::reset_individuals(const SimulationSettings& settings)
+{
+	const std::size_t ray_count = std::size_t(std::max(settings.ray_count, 1));
+
+	// the cars were built for the first population, keep the same count
+	const std::size_t population_size
+		= _population.empty() ? std::size_t(settings.population_size) : _population.size();
+
 	_population.clear();
-	_population.resize(_sim.cars.size());
+	_population.resize(population_size);
+
+	// randomize reads the mutator settings, which the UI may be editing
+	std::lock_guard lock(_settings_mutex);
 
 	for (std::size_t i = 0; i < _population.size(); ++i)
 	{
@@ -637,7 +1051,7 @@ void App::reset_individuals()
 
 		individual.car_id = i;
 
-		individual.network = Network(total_rays + 4, total_rays + 6);
+		individual.network = Network(ray_count + 4, ray_count + Axon_FirstRay);
 		_mutator.randomize(individual.network);
 		/*
 				auto& inputs  = individual.network.inputs().neurons;
@@ -691,8 +1105,6 @@ std::vector<MapSettings> App::make_default_map_pool()
 
 int main()
 {
-	tbb::task_scheduler_init init;
-
 	App app;
 	app.run();
 }
@@ -2,6 +2,8 @@
 
 #include <carnn/neural/network.hpp>
 #include <carnn/util/maths.hpp>
+#include <cmath>
+#include <cstring>
 #include <fmt/core.h>
 #include <random>
 
@@ -11,62 +13,139 @@ constexpr float layer_padding       = 256.0f;
 constexpr float neuron_area         = 700.0f;
 constexpr float hidden_layer_jitter = 160.0f;
 
-constexpr float neuron_radius = 12.0f;
+constexpr float       neuron_radius   = 12.0f;
+constexpr std::size_t neuron_segments = 16;
 
-Visualizer::Visualizer(const Network& network) : _network(&network) {}
+const sf::Vector2f global_origin(16.0f, 32.0f);
 
-void Visualizer::display(sf::RenderTarget& target, sf::Font& font)
+const sf::Color inactive_color(255, 50, 0), active_color(0, 255, 50);
+
+void Visualizer::display(sf::RenderTarget& target, const sf::Font& font, const Network& network)
 {
-	const sf::Vector2f global_origin(16.0f, 32.0f);
+	if (topology_changed(font, network))
+	{
+		build_layout(font, network);
+	}
 
-	const sf::Color inactive_color(255, 50, 0), active_color(0, 255, 50);
+	update_colors(network);
 
-	for (const Synapse& synapse : _network->synapses)
+	target.draw(_synapse_lines);
+	target.draw(_neuron_circles);
+
+	for (const sf::Text& label : _labels)
 	{
-		const Neuron& neuron = _network->neurons[synapse.source];
+		target.draw(label);
+	}
+}
 
-		sf::Vector2f source_origin = global_origin + neuron_offset(_network->neuron_position(synapse.source));
-		sf::Vector2f target_origin = global_origin + neuron_offset(_network->neuron_position(synapse.target));
+bool Visualizer::topology_changed(const sf::Font& font, const Network& network)
+{
+	_next_signature.clear();
 
-		std::uint8_t alpha = util::lerp(255u, 64u, std::abs(synapse.properties.weight) * 4.0);
+	for (const auto& layer : network.layers())
+	{
+		_next_signature.push_back(layer.size());
+	}
 
-		sf::Color origin_color = util::lerp_rgb(inactive_color, active_color, neuron.value);
-		sf::Color target_color = util::lerp_rgb(inactive_color, active_color, synapse.properties.weight);
-		origin_color.a = target_color.a = alpha;
+	for (const Synapse& synapse : network.synapses)
+	{
+		_next_signature.push_back((std::uint64_t(synapse.source) << 16) | synapse.target);
+	}
 
-		std::array<sf::Vertex, 2> vertices{
-			sf::Vertex(source_origin, origin_color), sf::Vertex(target_origin, target_color)};
-		target.draw(vertices.data(), vertices.size(), sf::Lines);
+	// labels show the activation method and bias of each neuron
+	for (const Neuron& neuron : network.neurons)
+	{
+		std::uint64_t bias_bits = 0;
+		std::memcpy(&bias_bits, &neuron.bias, sizeof(neuron.bias));
+		_next_signature.push_back(std::uint64_t(neuron.activation_method));
+		_next_signature.push_back(bias_bits);
 	}
 
-	for (std::size_t layer_id = 0; layer_id < _network->layers().size(); ++layer_id)
+	return &font != _font || _next_signature != _signature;
+}
+
+void Visualizer::build_layout(const sf::Font& font, const Network& network)
+{
+	_signature.swap(_next_signature);
+	_font = &font;
+
+	_neuron_origins.resize(network.neurons.size());
+
+	for (std::size_t id = 0; id < network.neurons.size(); ++id)
 	{
-		const auto layer = _network->layers()[layer_id];
-		for (std::size_t neuron_id = 0; neuron_id < layer.size(); ++neuron_id)
+		const NeuronPosition position = network.neuron_position(NeuronId(id));
+		_neuron_origins[id]
+			= global_origin + neuron_offset(position, network.layers()[position.layer].size());
+	}
+
+	_synapse_lines.resize(network.synapses.size() * 2);
+
+	for (std::size_t i = 0; i < network.synapses.size(); ++i)
+	{
+		const Synapse& synapse           = network.synapses[i];
+		_synapse_lines[i * 2].position     = _neuron_origins[synapse.source];
+		_synapse_lines[i * 2 + 1].position = _neuron_origins[synapse.target];
+	}
+
+	_neuron_circles.resize(network.neurons.size() * neuron_segments * 3);
+	_labels.resize(network.neurons.size());
+
+	for (std::size_t id = 0; id < network.neurons.size(); ++id)
+	{
+		const sf::Vector2f origin = _neuron_origins[id];
+
+		for (std::size_t segment = 0; segment < neuron_segments; ++segment)
 		{
-			const Neuron& neuron = layer[neuron_id];
+			const auto point = [&](std::size_t i) {
+				const float angle = float(i) * 2.0f * float(M_PI) / float(neuron_segments);
+				return origin + sf::Vector2f{std::cos(angle), std::sin(angle)} * neuron_radius;
+			};
+
+			sf::Vertex* triangle  = &_neuron_circles[(id * neuron_segments + segment) * 3];
+			triangle[0].position = origin;
+			triangle[1].position = point(segment);
+			triangle[2].position = point(segment + 1);
+		}
+
+		const Neuron& neuron = network.neurons[id];
+
+		sf::Text& label = _labels[id];
+		label.setFont(font);
+		label.setCharacterSize(16);
+		label.setPosition(origin);
+		label.setString(fmt::format("{} (bias: {:.01f})", name(neuron.activation_method), neuron.bias));
+	}
+}
 
-			sf::Vector2f origin = global_origin + neuron_offset({layer_id, neuron_id});
+void Visualizer::update_colors(const Network& network)
+{
+	for (std::size_t i = 0; i < network.synapses.size(); ++i)
+	{
+		const Synapse& synapse = network.synapses[i];
+		const Neuron&  neuron  = network.neurons[synapse.source];
 
-			// the neuron itself
-			sf::CircleShape shape(neuron_radius, 16);
+		std::uint8_t alpha = util::lerp(255u, 64u, std::abs(synapse.properties.weight) * 4.0);
 
-			shape.setPosition(origin - sf::Vector2f(neuron_radius, neuron_radius));
-			shape.setFillColor(util::lerp_rgb(inactive_color, active_color, neuron.value));
+		sf::Color origin_color = util::lerp_rgb(inactive_color, active_color, neuron.value);
+		sf::Color target_color = util::lerp_rgb(inactive_color, active_color, synapse.properties.weight);
+		origin_color.a = target_color.a = alpha;
 
-			target.draw(shape);
+		_synapse_lines[i * 2].color     = origin_color;
+		_synapse_lines[i * 2 + 1].color = target_color;
+	}
 
-			sf::Text text;
-			text.setFont(font);
-			text.setCharacterSize(16);
-			text.setPosition(origin);
-			text.setString(fmt::format("{} (bias: {:.01f})", name(neuron.activation_method), neuron.bias));
-			target.draw(text);
+	for (std::size_t id = 0; id < network.neurons.size(); ++id)
+	{
+		const sf::Color color = util::lerp_rgb(inactive_color, active_color, network.neurons[id].value);
+
+		for (std::size_t i = 0; i < neuron_segments * 3; ++i)
+		{
+			_neuron_circles[id * neuron_segments * 3 + i].color = color;
 		}
 	}
 }
 
-sf::Vector2f Visualizer::neuron_offset(NeuronPosition pos)
+sf::Vector2f Visualizer::neuron_offset(NeuronPosition pos, std::size_t layer_size) const
 {
 	float jitter = 0.0f;
 
@@ -80,6 +159,6 @@ sf::Vector2f Visualizer::neuron_offset(NeuronPosition pos)
 
 	return {
 		std::round(float(pos.layer) * layer_padding + jitter),
-		std::round(float(pos.neuron_in_layer) / float(_network->layers()[pos.layer].size()) * neuron_area)};
+		std::round(float(pos.neuron_in_layer) / float(layer_size) * neuron_area)};
 }
 } // namespace neural
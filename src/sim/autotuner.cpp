@@ -0,0 +1,135 @@
+#include <carnn/sim/autotuner.hpp>
+
+#include <array>
+#include <carnn/sim/individual.hpp>
+#include <carnn/sim/scheduler.hpp>
+#include <carnn/sim/simulationunit.hpp>
+#include <cereal/archives/json.hpp>
+#include <chrono>
+#include <fstream>
+#include <limits>
+#include <spdlog/spdlog.h>
+
+namespace sim
+{
+// rough memory footprint of a car: its 5 bodies, joints, fixtures, contacts and shapes, plus its network
+constexpr std::size_t car_footprint = 8 * 1024;
+
+constexpr std::array<std::size_t, 5> units_per_core_candidates{1, 2, 4, 8, 16};
+
+constexpr std::size_t warmup_ticks = 5, calibration_ticks = 30;
+
+AutoTuner::AutoTuner(Topology topology, Placement& placement) : _topology(topology), _placement(placement) {}
+
+TuningResult AutoTuner::tune(
+	const MapSettings&        map,
+	const SimulationSettings& settings,
+	std::vector<Individual>&  population,
+	const TickStages&         stages)
+{
+	TuningResult result;
+	result.topology = _topology;
+
+	if (settings.unit_count > 0)
+	{
+		result.unit_count = std::size_t(settings.unit_count);
+	}
+	else
+	{
+		double best_seconds = std::numeric_limits<double>::infinity();
+
+		// candidates come in increasing order. more units cost more memory and setup time, so only switch to a
+		// larger count when it is noticeably faster.
+		for (const std::size_t unit_count : candidate_unit_counts(population.size()))
+		{
+			const double seconds = measure(map, settings, unit_count, population, stages);
+			spdlog::info("calibration: {} units take {:.3f}ms per tick", unit_count, seconds * 1000.0);
+
+			if (seconds < best_seconds * 0.95)
+			{
+				best_seconds      = seconds;
+				result.unit_count = unit_count;
+			}
+		}
+
+		result.calibrated       = true;
+		result.seconds_per_tick = best_seconds;
+	}
+
+	result.cars_per_unit = (population.size() + result.unit_count - 1) / result.unit_count;
+
+	report(result);
+	return result;
+}
+
+std::vector<std::size_t> AutoTuner::candidate_unit_counts(const std::size_t population_size) const
+{
+	// the cars of a unit are stepped together, so try to keep them within the L2 of the core stepping them
+	const std::size_t max_cars_per_unit = std::max<std::size_t>(1, _topology.l2_cache_size / car_footprint);
+	const std::size_t max_unit_count    = std::max<std::size_t>(1, population_size);
+
+	// units never straddle NUMA nodes, so give every node at least one
+	const std::size_t min_unit_count = std::max(
+		(population_size + max_cars_per_unit - 1) / max_cars_per_unit,
+		std::min(_placement.node_count(), max_unit_count));
+
+	std::vector<std::size_t> candidates;
+
+	for (const std::size_t units_per_core : units_per_core_candidates)
+	{
+		const std::size_t unit_count = std::min(_topology.core_count * units_per_core, max_unit_count);
+
+		if (unit_count >= min_unit_count && (candidates.empty() || candidates.back() != unit_count))
+		{
+			candidates.push_back(unit_count);
+		}
+	}
+
+	if (candidates.empty())
+	{
+		candidates.push_back(std::min(min_unit_count, max_unit_count));
+	}
+
+	return candidates;
+}
+
+double AutoTuner::measure(
+	const MapSettings&        map,
+	const SimulationSettings& settings,
+	const std::size_t         unit_count,
+	std::vector<Individual>&  population,
+	const TickStages&         stages) const
+{
+	Simulation trial{map, settings, unit_count, _placement};
+
+	trial.attach(population);
+
+	const float no_limit = std::numeric_limits<float>::infinity();
+
+	Scheduler scheduler;
+	scheduler.advance(trial, warmup_ticks, no_limit, stages);
+
+	const auto start = std::chrono::steady_clock::now();
+	scheduler.advance(trial, calibration_ticks, no_limit, stages);
+	const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	return elapsed.count() / double(calibration_ticks);
+}
+
+void AutoTuner::report(const TuningResult& result) const
+{
+	spdlog::info(
+		"running {} units of {} cars on {} cores (L2 {} KiB, L3 {} KiB), {}",
+		result.unit_count,
+		result.cars_per_unit,
+		result.topology.core_count,
+		result.topology.l2_cache_size / 1024,
+		result.topology.l3_cache_size / 1024,
+		result.calibrated ? "calibrated" : "set by the simulation settings");
+
+	TuningResult              serialized = result;
+	std::ofstream             os("tuning.json", std::ios::binary);
+	cereal::JSONOutputArchive ar(os);
+	serialized.serialize(ar);
+}
+} // namespace sim
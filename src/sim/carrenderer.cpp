@@ -0,0 +1,122 @@
+#include <carnn/sim/carrenderer.hpp>
+
+#include <algorithm>
+#include <carnn/sim/entities/car.hpp>
+#include <carnn/sim/snapshot.hpp>
+#include <cstdint>
+
+namespace sim
+{
+namespace
+{
+constexpr float border_thickness = 0.08f;
+
+const sf::Color wheel_fill{20, 20, 20, 40};
+
+/// Fill lightened by a fifth of full intensity, with an opaque outline
+sf::Color border_color(const sf::Color fill)
+{
+	const auto lighten = [](std::uint8_t c) { return std::uint8_t(std::min(255, int(c) + 51)); };
+	return {lighten(fill.r), lighten(fill.g), lighten(fill.b), 255};
+}
+} // namespace
+
+CarRenderer::CarRenderer() :
+	_car_mesh(make_mesh(entities::Car::body_vertices, border_thickness)),
+	_wheel_mesh(make_mesh(entities::Car::wheel_vertices, border_thickness))
+{}
+
+void CarRenderer::clear()
+{
+	_triangles.clear();
+	_lines.clear();
+}
+
+void CarRenderer::add(const CarSnapshot& car, const sf::Color fill)
+{
+	if (!car.dead)
+	{
+		for (const sf::Vertex& vertex : car.rays)
+		{
+			_lines.append(vertex);
+		}
+	}
+
+	add_mesh(_car_mesh, car.body, fill, border_color(fill));
+
+	for (const b2Transform& wheel : car.wheels)
+	{
+		add_mesh(_wheel_mesh, wheel, wheel_fill, border_color(wheel_fill));
+	}
+}
+
+void CarRenderer::draw(sf::RenderTarget& target) const
+{
+	target.draw(_lines);
+	target.draw(_triangles);
+}
+
+CarRenderer::Mesh CarRenderer::make_mesh(const std::array<b2Vec2, 8>& vertices, const float thickness)
+{
+	Mesh mesh;
+
+	b2Vec2 center{0.0f, 0.0f};
+	for (const b2Vec2& v : vertices)
+	{
+		center += (1.0f / float(vertices.size())) * v;
+	}
+
+	for (std::size_t i = 1; i + 1 < vertices.size(); ++i)
+	{
+		mesh.fill.insert(mesh.fill.end(), {vertices[0], vertices[i], vertices[i + 1]});
+	}
+
+	// offsets each vertex outwards along the bisector of its two edges, the way sf::Shape builds its outline
+	const auto edge_normal = [&](const b2Vec2& a, const b2Vec2& b) {
+		b2Vec2 normal{a.y - b.y, b.x - a.x};
+		normal.Normalize();
+		return b2Dot(normal, a - center) < 0.0f ? -normal : normal;
+	};
+
+	std::array<b2Vec2, 8> outer;
+
+	for (std::size_t i = 0; i < vertices.size(); ++i)
+	{
+		const b2Vec2& previous = vertices[(i + vertices.size() - 1) % vertices.size()];
+		const b2Vec2& current  = vertices[i];
+		const b2Vec2& next     = vertices[(i + 1) % vertices.size()];
+
+		const b2Vec2 n1 = edge_normal(previous, current);
+		const b2Vec2 n2 = edge_normal(current, next);
+
+		const float factor = 1.0f + b2Dot(n1, n2);
+		outer[i]           = current + (thickness / factor) * (n1 + n2);
+	}
+
+	for (std::size_t i = 0; i < vertices.size(); ++i)
+	{
+		const std::size_t j = (i + 1) % vertices.size();
+		mesh.border.insert(mesh.border.end(), {vertices[i], outer[i], outer[j], vertices[i], outer[j], vertices[j]});
+	}
+
+	return mesh;
+}
+
+void CarRenderer::add_mesh(const Mesh& mesh, const b2Transform& transform, const sf::Color fill, const sf::Color border)
+{
+	const auto append = [&](const b2Vec2& local, const sf::Color color) {
+		const b2Vec2 world = b2Mul(transform, local);
+		_triangles.append(sf::Vertex{sf::Vector2f{world.x, world.y}, color});
+	};
+
+	for (const b2Vec2& v : mesh.fill)
+	{
+		append(v, fill);
+	}
+
+	for (const b2Vec2& v : mesh.border)
+	{
+		append(v, border);
+	}
+}
+} // namespace sim
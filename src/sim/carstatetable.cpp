@@ -0,0 +1,224 @@
+#include <carnn/sim/carstatetable.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <carnn/neural/network.hpp>
+#include <carnn/sim/entities/checkpoint.hpp>
+#include <carnn/sim/kinematics.hpp>
+#include <carnn/util/halfturn.hpp>
+#include <carnn/util/maths.hpp>
+#include <cmath>
+
+namespace sim
+{
+void CarStateTable::resize(const std::size_t car_count, const std::size_t ray_count)
+{
+	for (std::vector<float>* column :
+		 {&position_x,
+		  &position_y,
+		  &heading_cos,
+		  &heading_sin,
+		  &forward_speed,
+		  &lateral_speed,
+		  &objective_x,
+		  &objective_y,
+		  &objective_cos,
+		  &objective_sin,
+		  &throttle,
+		  &steering,
+		  &brake,
+		  &drift})
+	{
+		column->resize(car_count);
+	}
+
+	for (std::vector<std::vector<float>>* columns : {&ray_angle, &ray_dir_x, &ray_dir_y, &ray_fraction})
+	{
+		columns->resize(ray_count);
+
+		for (std::vector<float>& column : *columns)
+		{
+			column.resize(car_count);
+		}
+	}
+
+	has_objective.resize(car_count);
+	network.resize(car_count);
+}
+
+void CarStateTable::reset()
+{
+	for (std::size_t ray = 0; ray < ray_count(); ++ray)
+	{
+		std::fill(ray_angle[ray].begin(), ray_angle[ray].end(), 0.0f);
+		std::fill(ray_fraction[ray].begin(), ray_fraction[ray].end(), 1.0f);
+	}
+
+	for (std::vector<float>* column : {&throttle, &steering, &brake, &drift})
+	{
+		std::fill(column->begin(), column->end(), 0.0f);
+	}
+
+	ray_ticks = 0;
+}
+
+void CarStateTable::gather(const std::vector<entities::Car*>& cars, const std::vector<std::uint32_t>& live_cars)
+{
+	for (const std::uint32_t i : live_cars)
+	{
+		entities::Car& car  = *cars[i];
+		const b2Body&  body = car.get();
+
+		gather_car(i, car, body.GetPosition(), body.GetTransform().q, body.GetLinearVelocity());
+	}
+}
+
+void CarStateTable::gather(
+	const std::vector<entities::Car*>& cars,
+	const CarKinematics&               kinematics,
+	const std::vector<std::uint32_t>&  live_cars)
+{
+	for (const std::uint32_t i : live_cars)
+	{
+		const b2Transform xf = kinematics.transform(i);
+
+		gather_car(i, *cars[i], xf.p, xf.q, {kinematics.velocity_x[i], kinematics.velocity_y[i]});
+	}
+}
+
+void CarStateTable::gather_car(
+	const std::size_t    i,
+	const entities::Car& car,
+	const b2Vec2         position,
+	const b2Rot&         rot,
+	const b2Vec2         velocity)
+{
+	position_x[i]  = position.x;
+	position_y[i]  = position.y;
+	heading_cos[i] = rot.c;
+	heading_sin[i] = rot.s;
+
+	// front is local -y, lateral is local +x, as in Body::front_normal and Body::lateral_normal
+	forward_speed[i] = std::abs(b2Dot(b2Vec2{rot.s, -rot.c}, velocity));
+	lateral_speed[i] = std::abs(b2Dot(b2Vec2{rot.c, rot.s}, velocity));
+
+	const entities::Checkpoint* objective = car.target_checkpoint();
+	has_objective[i]                      = objective != nullptr;
+
+	if (objective != nullptr)
+	{
+		objective_x[i] = objective->origin.x;
+		objective_y[i] = objective->origin.y;
+	}
+}
+
+void CarStateTable::sense(const std::vector<std::uint32_t>& live_cars)
+{
+	// The objective direction is (cos, sin) of the body angle minus the angle of the direction to the objective, i.e.
+	// the dot and cross products of the two unit vectors. The front of the car is local -y.
+	for (const std::uint32_t i : live_cars)
+	{
+		const float dx = objective_x[i] - position_x[i], dy = objective_y[i] - position_y[i];
+		const float length_squared = dx * dx + dy * dy;
+		const float inverse_length
+			= has_objective[i] && length_squared > 0.0f ? 1.0f / std::sqrt(length_squared) : 0.0f;
+
+		const float front_x = heading_sin[i], front_y = -heading_cos[i];
+
+		objective_cos[i] = (front_x * dx + front_y * dy) * inverse_length;
+		objective_sin[i] = (dx * front_y - dy * front_x) * inverse_length;
+	}
+
+	// rays point `ray_angle` half turns clockwise from the body angle: rotate the heading by the opposite angle
+	for (std::size_t ray = 0; ray < ray_count(); ++ray)
+	{
+		const std::vector<float>& angles = ray_angle[ray];
+		std::vector<float>&       dir_x  = ray_dir_x[ray];
+		std::vector<float>&       dir_y  = ray_dir_y[ray];
+
+		for (const std::uint32_t i : live_cars)
+		{
+			const auto [c, s] = util::half_turn(angles[i]);
+
+			dir_x[i] = (heading_cos[i] * c + heading_sin[i] * s) * ray_radius;
+			dir_y[i] = (heading_sin[i] * c - heading_cos[i] * s) * ray_radius;
+		}
+	}
+}
+
+void CarStateTable::scatter(const std::vector<entities::Car*>& cars, const std::vector<std::uint32_t>& live_cars) const
+{
+	for (const std::uint32_t i : live_cars)
+	{
+		entities::Car& car = *cars[i];
+		car.set_drift(drift[i]);
+		car.steer(steering[i]);
+		car.accelerate(throttle[i]);
+		car.brake(brake[i]);
+	}
+}
+
+std::pair<b2Vec2, b2Vec2> CarStateTable::ray_segment(const std::size_t car, const std::size_t ray) const
+{
+	const b2Vec2 p1{position_x[car], position_y[car]};
+	const b2Vec2 p2{p1.x + ray_dir_x[ray][car], p1.y + ray_dir_y[ray][car]};
+
+	return {p1, p2};
+}
+
+void CarStateTable::append_ray_vertices(const std::size_t car, std::vector<sf::Vertex>& vertices) const
+{
+	for (std::size_t ray = 0; ray < ray_count(); ++ray)
+	{
+		const float fraction = ray_fraction[ray][car];
+		const auto [p1, p2]  = ray_segment(car, ray);
+		const b2Vec2 hit     = p1 + fraction * (p2 - p1);
+
+		const sf::Color color{
+			static_cast<uint8_t>(util::lerp(200, 0, fraction)),
+			static_cast<uint8_t>(util::lerp(0, 200, fraction)),
+			0,
+			static_cast<uint8_t>(util::lerp(150, 0, fraction))};
+
+		vertices.push_back(sf::Vertex{sf::Vector2f{p1.x, p1.y}, color});
+		vertices.push_back(sf::Vertex{sf::Vector2f{hit.x, hit.y}, color});
+	}
+}
+
+void CarStateTable::load_inputs(const std::size_t car, neural::Network& network) const
+{
+	auto inputs = network.inputs();
+
+	assert(inputs.size() == ray_count() + 4);
+
+	std::size_t i = 0;
+
+	inputs[i++].partial_activation = objective_cos[car] * 0.5 + 0.5;
+	inputs[i++].partial_activation = objective_sin[car] * 0.5 + 0.5;
+	inputs[i++].partial_activation = util::lerp(0.0, 1.0, forward_speed[car] / full_speed);
+	inputs[i++].partial_activation = util::lerp(0.0, 1.0, lateral_speed[car] / 1.0f);
+
+	for (std::size_t ray = 0; ray < ray_count(); ++ray, ++i)
+	{
+		inputs[i].partial_activation = 1.0f - ray_fraction[ray][car];
+	}
+}
+
+void CarStateTable::store_outputs(const std::size_t car, const neural::Network& network)
+{
+	using namespace entities;
+
+	const auto results = network.outputs();
+
+	drift[car]    = static_cast<float>(results[Axon_Drift].value);
+	steering[car] = static_cast<float>(results[Axon_Steer_Right].value - results[Axon_Steer_Left].value);
+	throttle[car] = static_cast<float>(results[Axon_Forward].value - results[Axon_Backwards].value);
+	brake[car]    = results[Axon_Brake].value;
+
+	for (std::size_t ray = 0; ray < ray_count(); ++ray)
+	{
+		float& ray_angle_of_car = ray_angle[ray][car];
+		ray_angle_of_car = util::lerp(ray_angle_of_car, std::clamp(results[Axon_FirstRay + ray].value, 0.0f, 1.0f), 0.1f);
+	}
+}
+} // namespace sim
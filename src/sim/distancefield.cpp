@@ -0,0 +1,152 @@
+#include <carnn/sim/distancefield.hpp>
+
+#include <algorithm>
+#include <carnn/util/maths.hpp>
+#include <limits>
+#include <spdlog/spdlog.h>
+#include <tbb/tbb.h>
+
+namespace sim
+{
+static float segment_distance(b2Vec2 p, const util::Line& line)
+{
+	const b2Vec2 a{line.p1.x, line.p1.y}, b{line.p2.x, line.p2.y};
+	const b2Vec2 ab = b - a;
+
+	const float length_squared = b2Dot(ab, ab);
+	const float t              = length_squared > 0.0f ? util::clamp(b2Dot(p - a, ab) / length_squared, 0.0f, 1.0f) : 0.0f;
+
+	return (p - (a + t * ab)).Length();
+}
+
+DistanceField::DistanceField(const std::vector<util::Line>& walls, const float resolution) : _resolution(resolution)
+{
+	if (walls.empty())
+	{
+		return;
+	}
+
+	b2Vec2 lower{std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+	b2Vec2 upper{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+	for (const util::Line& line : walls)
+	{
+		for (const sf::Vector2f& p : {line.p1, line.p2})
+		{
+			lower = {std::min(lower.x, p.x), std::min(lower.y, p.y)};
+			upper = {std::max(upper.x, p.x), std::max(upper.y, p.y)};
+		}
+	}
+
+	// pad by a couple of samples so that every wall is surrounded by samples on all sides
+	const float padding = 2.0f * _resolution;
+	_origin             = lower - b2Vec2{padding, padding};
+	_width              = std::size_t((upper.x - lower.x + 2.0f * padding) / _resolution) + 1;
+	_height             = std::size_t((upper.y - lower.y + 2.0f * padding) / _resolution) + 1;
+	_distances.resize(_width * _height);
+
+	spdlog::info("building {}x{} distance field from {} wall segments", _width, _height, walls.size());
+
+	// bucket the walls so that each sample only has to look at the walls around it. walls are tiny compared to the
+	// buckets, so registering them in the bucket of their first point and widening the search by one bucket is enough.
+	const float       bucket_size = 8.0f * _resolution + 16.0f;
+	const std::size_t buckets_x   = std::size_t((_width * _resolution) / bucket_size) + 1;
+	const std::size_t buckets_y   = std::size_t((_height * _resolution) / bucket_size) + 1;
+
+	std::vector<std::vector<const util::Line*>> buckets(buckets_x * buckets_y);
+	float                                       max_wall_length = 0.0f;
+	for (const util::Line& line : walls)
+	{
+		const auto bx = std::size_t((line.p1.x - _origin.x) / bucket_size);
+		const auto by = std::size_t((line.p1.y - _origin.y) / bucket_size);
+		buckets[by * buckets_x + bx].push_back(&line);
+
+		max_wall_length = std::max(max_wall_length, util::distance(line.p1, line.p2));
+	}
+
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, _height), [&](const auto& rows) {
+		for (std::size_t y = rows.begin(); y != rows.end(); ++y)
+		{
+			for (std::size_t x = 0; x < _width; ++x)
+			{
+				const b2Vec2 p  = _origin + b2Vec2{float(x) * _resolution, float(y) * _resolution};
+				const auto   bx = long((p.x - _origin.x) / bucket_size);
+				const auto   by = long((p.y - _origin.y) / bucket_size);
+
+				float closest = std::numeric_limits<float>::max();
+
+				// search rings of buckets of growing radius until none of the remaining ones may hold a closer wall
+				for (long ring = 0;; ++ring)
+				{
+					for (long ry = by - ring; ry <= by + ring; ++ry)
+					{
+						for (long rx = bx - ring; rx <= bx + ring; ++rx)
+						{
+							const bool on_ring = std::abs(ry - by) == ring || std::abs(rx - bx) == ring;
+							if (!on_ring || rx < 0 || ry < 0 || rx >= long(buckets_x) || ry >= long(buckets_y))
+							{
+								continue;
+							}
+
+							for (const util::Line* line : buckets[std::size_t(ry) * buckets_x + std::size_t(rx)])
+							{
+								closest = std::min(closest, segment_distance(p, *line));
+							}
+						}
+					}
+
+					const bool covers_grid = ring >= long(std::max(buckets_x, buckets_y));
+					if (closest <= float(ring) * bucket_size - max_wall_length || covers_grid)
+					{
+						break;
+					}
+				}
+
+				_distances[y * _width + x] = closest;
+			}
+		}
+	});
+}
+
+float DistanceField::distance(const b2Vec2 p) const
+{
+	const float fx = std::round((p.x - _origin.x) / _resolution);
+	const float fy = std::round((p.y - _origin.y) / _resolution);
+
+	if (fx < 0.0f || fy < 0.0f || fx >= float(_width) || fy >= float(_height))
+	{
+		return std::numeric_limits<float>::infinity();
+	}
+
+	return _distances[std::size_t(fy) * _width + std::size_t(fx)];
+}
+
+float DistanceField::raycast(const b2Vec2 p1, const b2Vec2 p2) const
+{
+	b2Vec2      dir    = p2 - p1;
+	const float length = dir.Normalize();
+
+	const float error         = lookup_error();
+	const float hit_threshold = 2.0f * error;
+
+	// every step is at least `error` long since we stop as soon as the lookup goes below `hit_threshold`, and it can
+	// never cross a wall since the true distance is at least `lookup - error`.
+	for (float t = 0.0f; t < length;)
+	{
+		const float d = distance(p1 + t * dir);
+
+		if (d <= hit_threshold)
+		{
+			return t / length;
+		}
+
+		t += d - error;
+	}
+
+	return 1.0f;
+}
+
+float DistanceField::lookup_error() const { return _resolution * 0.5f * std::sqrt(2.0f); }
+
+float DistanceField::max_error() const { return 3.0f * lookup_error(); }
+} // namespace sim
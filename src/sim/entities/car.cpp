@@ -1,35 +1,53 @@
 #include <carnn/sim/entities/car.hpp>
 
-#include <carnn/neural/network.hpp>
 #include <carnn/sim/entities/checkpoint.hpp>
 #include <carnn/sim/entities/wheel.hpp>
 #include <carnn/sim/simulationunit.hpp>
 #include <carnn/sim/world.hpp>
+#include <carnn/util/halfturn.hpp>
+#include <carnn/util/line.hpp>
 #include <carnn/util/maths.hpp>
 #include <carnn/util/random.hpp>
 
 namespace sim::entities
 {
-void CarCheckpointListener::BeginContact(b2Contact* contact)
+void CarWallListener::BeginContact(b2Contact* contact)
 {
 	b2Fixture *   fixA = contact->GetFixtureA(), *fixB = contact->GetFixtureB();
 	auto &bodyA_BUD = *reinterpret_cast<BodyUserData*>(fixA->GetBody()->GetUserData().pointer),
 		 &bodyB_BUD = *reinterpret_cast<BodyUserData*>(fixB->GetBody()->GetUserData().pointer);
 
-	if (bodyA_BUD.type == BodyType::BodyCar && bodyB_BUD.type == BodyType::BodyCheckpoint)
-		static_cast<Car*>(bodyA_BUD.body)->contact_checkpoint(*static_cast<Checkpoint*>(bodyB_BUD.body));
-	else if (bodyB_BUD.type == BodyType::BodyCar && bodyA_BUD.type == BodyType::BodyCheckpoint)
-		static_cast<Car*>(bodyB_BUD.body)->contact_checkpoint(*static_cast<Checkpoint*>(bodyA_BUD.body));
-
 	if (bodyA_BUD.type == BodyType::BodyCar && bodyB_BUD.type == BodyType::BodyWall)
 		static_cast<Car*>(bodyA_BUD.body)->wall_collision();
 	else if (bodyB_BUD.type == BodyType::BodyCar && bodyA_BUD.type == BodyType::BodyWall)
 		static_cast<Car*>(bodyB_BUD.body)->wall_collision();
 }
 
-void CarCheckpointListener::EndContact(b2Contact*) {}
-
-Car::Car(World& world, const b2BodyDef bdef, const bool do_render) : Body(world, bdef, do_render)
+void CarWallListener::EndContact(b2Contact*) {}
+
+const std::array<b2Vec2, 8> Car::body_vertices
+	= {{{-1.50f, -0.30f},
+		{-1.00f, -1.90f},
+		{-0.50f, -2.10f},
+		{0.50f, -2.10f},
+		{1.00f, -1.90f},
+		{1.50f, -0.30f},
+		{1.50f, 2.00f},
+		{-1.50f, 2.00f}}};
+
+const std::array<b2Vec2, 8> Car::wheel_vertices
+	= {{{-0.20f, -0.25f},
+		{-0.12f, -0.30f},
+		{0.12f, -0.30f},
+		{0.20f, -0.25f},
+		{0.20f, 0.25f},
+		{0.12f, 0.30f},
+		{-0.12f, 0.30f},
+		{-0.20f, 0.25f}}};
+
+const std::array<b2Vec2, 4> Car::wheel_anchors = {{{-1.8f, -1.0f}, {1.8f, -1.0f}, {-1.8f, 2.0f}, {1.8f, 2.0f}}};
+
+Car::Car(World& world, const b2BodyDef bdef) : Body(world, bdef)
 {
 	set_type(BodyType::BodyCar);
 
@@ -48,18 +66,8 @@ Car::Car(World& world, const b2BodyDef bdef, const bool do_render) : Body(world,
 		bdef.position = {0.f, 0.f};
 		bdef.type     = b2_dynamicBody;
 
-		std::array<b2Vec2, 8> vertices
-			= {{{-0.20f, -0.25f},
-				{-0.12f, -0.30f},
-				{0.12f, -0.30f},
-				{0.20f, -0.25f},
-				{0.20f, 0.25f},
-				{0.12f, 0.30f},
-				{-0.12f, 0.30f},
-				{-0.20f, 0.25f}}};
-
 		b2PolygonShape shape;
-		shape.Set(vertices.data(), vertices.size());
+		shape.Set(wheel_vertices.data(), wheel_vertices.size());
 
 		b2FixtureDef fixdef;
 		fixdef.shape             = &shape;
@@ -69,18 +77,17 @@ Car::Car(World& world, const b2BodyDef bdef, const bool do_render) : Body(world,
 
 		_wheels.push_back(&_world.add_body<Wheel>(bdef));
 		Wheel* w = _wheels.back();
-		w->with_color(sf::Color{20, 20, 20, 40}).add_fixture(fixdef);
+		w->add_fixture(fixdef);
 
-		rjdef.bodyB = &w->get();
+		rjdef.bodyB        = &w->get();
+		rjdef.localAnchorA = wheel_anchors[i];
 
 		if (i < 2)
 		{
-			rjdef.localAnchorA.Set(-1.8f + (i * 3.6f), -1);
 			_front_joints[i] = dynamic_cast<b2RevoluteJoint*>(_world.get().CreateJoint(&rjdef));
 		}
 		else
 		{
-			rjdef.localAnchorA.Set(-1.8f + ((i - 2) * 3.6f), 2);
 			_world.get().CreateJoint(&rjdef);
 		}
 	}
@@ -88,22 +95,52 @@ Car::Car(World& world, const b2BodyDef bdef, const bool do_render) : Body(world,
 
 void Car::update()
 {
-	_body->SetSleepingAllowed(true);
-	_body->SetAwake(!dead);
+	const b2Vec2 position = body_transform().p;
+
+	cross_checkpoints(_previous_position, position);
+	_previous_position = position;
 
 	if (dead)
 	{
+		// the last step may have crossed a checkpoint before hitting the wall
+		update_fitness();
+		retire();
 		return;
 	}
 
-	for (Wheel* wheel : _wheels)
+	// kinematic cars have their tires applied by CarKinematics, and their body left alone
+	if (_model != VehicleModel::Kinematic)
 	{
-		wheel->cancel_lateral_force(util::lerp(1.f, 0.1f, _drift_amount));
-		wheel->drag(_brake_amount);
-		wheel->update();
+		_body->SetAwake(true);
 	}
 
-	Body::update();
+	if (_model == VehicleModel::SingleBody)
+	{
+		_steer_angle = _next_steer_angle;
+
+		for (std::size_t i = 0; i < wheel_anchors.size(); ++i)
+		{
+			const b2Body& wheel_body = _wheels[i]->get();
+			const float   angle      = i < 2 ? _steer_angle : 0.0f;
+
+			Wheel::cancel_lateral_force(
+				*_body,
+				wheel_anchors[i],
+				angle,
+				wheel_body.GetMass(),
+				wheel_body.GetInertia(),
+				util::lerp(1.f, 0.1f, _drift_amount));
+			Wheel::drag(*_body, wheel_anchors[i], angle, _brake_amount);
+		}
+	}
+	else if (_model == VehicleModel::Wheeled)
+	{
+		for (Wheel* wheel : _wheels)
+		{
+			wheel->cancel_lateral_force(util::lerp(1.f, 0.1f, _drift_amount));
+			wheel->drag(_brake_amount);
+		}
+	}
 
 	/*if (std::abs(_body->GetAngularVelocity()) > 0.5)
 	{
@@ -111,93 +148,67 @@ void Car::update()
 		fitness_penalty(10.0f);
 	}*/
 
-	_target_checkpoint = unit->checkpoints.at(reached_checkpoints() % unit->checkpoints.size());
+	_target_checkpoint = &unit->checkpoints.at(reached_checkpoints() % unit->checkpoints.size());
+
+	update_fitness();
 }
 
-void Car::render(sf::RenderTarget& target)
+void Car::retire()
 {
-	if (!dead)
+	unit->retire_car(unit_index);
+
+	// disabling the bodies also disables the joints between them
+	_world.disable_body(*this);
+	for (Wheel* wheel : _wheels)
 	{
-		target.draw(_rays.data(), _rays.size(), sf::Lines);
+		_world.disable_body(*wheel);
 	}
-
-	Body::render(target);
 }
 
-void Car::fast_render(sf::RenderTarget& target)
+void Car::cross_checkpoints(const b2Vec2 from, const b2Vec2 to)
 {
-	Body::render(target);
-}
+	const util::Line motion{{from.x, from.y}, {to.x, to.y}};
 
-void Car::contact_checkpoint(Checkpoint& cp)
-{
-	if (&cp == _target_checkpoint)
+	if (_target_checkpoint != nullptr && motion.intersects({_target_checkpoint->p1, _target_checkpoint->p2}))
 	{
 		++_reached_checkpoints;
-		_latest_checkpoint = &cp;
-		_target_checkpoint = unit->checkpoints.at(reached_checkpoints() % unit->checkpoints.size());
-	} else if (&cp != _latest_checkpoint) {
+		_latest_checkpoint = _target_checkpoint;
+		_target_checkpoint = &unit->checkpoints.at(reached_checkpoints() % unit->checkpoints.size());
+	}
+	else if (_latest_checkpoint != nullptr && motion.intersects({_latest_checkpoint->p1, _latest_checkpoint->p2}))
+	{
 		fitness_penalty(500000.0f);
 	}
 }
 
-void Car::set_target_checkpoint(Checkpoint* cp) { _target_checkpoint = cp; }
-
 std::size_t Car::reached_checkpoints() const { return _reached_checkpoints; }
 
-b2Vec2 Car::direction_to_objective() const
-{
-	if (_target_checkpoint == nullptr)
-	{
-		return {0.0f, 0.0f};
-	}
-
-	b2Vec2 worldspace_dir = b2Vec2{_target_checkpoint->origin.x, _target_checkpoint->origin.y} - _body->GetPosition();
-	worldspace_dir.Normalize();
-
-	b2Vec2 worldspace_car_dir = front_normal();
-
-	const float worldspace_angle = atan2(worldspace_dir.y, worldspace_dir.x);
-	const float body_angle       = atan2(worldspace_car_dir.y, worldspace_car_dir.x);
-	const float real_angle       = body_angle - worldspace_angle;
-
-	return b2Vec2(cos(real_angle), sin(real_angle));
-}
-
 float Car::fitness() const
 {
-	const sf::Vector2f body_origin{_body->GetPosition().x, _body->GetPosition().y};
-
 	if (reached_checkpoints() == 0)
 	{
 		return _fitness_bias;
 	}
 
-	if (_target_checkpoint == nullptr)
+	return _fitness + _fitness_bias;
+}
+
+void Car::update_fitness()
+{
+	if (reached_checkpoints() == 0 || _target_checkpoint == nullptr)
 	{
-		return _fitness + _fitness_bias;
+		return;
 	}
 
-	// this is extremely stupid but hey
-
-	const float body_distance = std::min(
-		{util::distance(body_origin, _target_checkpoint->origin),
-		 util::distance(body_origin, _target_checkpoint->p1),
-		 util::distance(body_origin, _target_checkpoint->p2)});
+	const b2Vec2       position = body_transform().p;
+	const sf::Vector2f offset   = sf::Vector2f{position.x, position.y} - _target_checkpoint->progress_origin;
+	const sf::Vector2f& axis = _target_checkpoint->progress_axis;
 
-	const float checkpoint_distance = std::max(
-		{util::distance(_target_checkpoint->p1, _latest_checkpoint->p1),
-		 util::distance(_target_checkpoint->p1, _latest_checkpoint->p2),
-		 util::distance(_target_checkpoint->p2, _latest_checkpoint->p1),
-		 util::distance(_target_checkpoint->p2, _latest_checkpoint->p2)});
-
-	const float normalized_distance = 1.0f - std::clamp(body_distance / checkpoint_distance, 0.0f, 1.0f);
+	const float progress = std::clamp(offset.x * axis.x + offset.y * axis.y, 0.0f, 1.0f);
 
 	const float scale = 1000.0f;
 
-	_fitness = ((reached_checkpoints() + 1) * scale + normalized_distance * scale * 0.8f);
-
-	return _fitness + _fitness_bias;
+	_fitness = ((reached_checkpoints() + 1) * scale + progress * scale * 0.8f);
 }
 
 void Car::fitness_penalty(float value)
@@ -221,12 +232,29 @@ void Car::accelerate(float by)
 {
 	by *= _acceleration_factor;
 
+	if (_model == VehicleModel::SingleBody)
+	{
+		for (size_t i = 0; i < 2; ++i)
+			Wheel::accelerate(*_body, wheel_anchors[i], _steer_angle, by);
+
+		return;
+	}
+
 	for (size_t i = 0; i < 2; ++i)
 		_wheels[i]->accelerate(by);
 }
 
 void Car::steer(float towards)
 {
+	if (_model == VehicleModel::SingleBody)
+	{
+		float desired_angle = util::lerp(-_angle_lock, _angle_lock, towards * 0.5 + 0.5);
+		float fspeed        = _turn_speed / 30.0f;
+
+		_next_steer_angle = _steer_angle + b2Clamp(desired_angle - _steer_angle, -fspeed, fspeed);
+		return;
+	}
+
 	for (size_t i = 0; i < 2; ++i)
 	{
 		float desired_angle = util::lerp(-_angle_lock, _angle_lock, towards * 0.5 + 0.5);
@@ -251,91 +279,128 @@ void Car::transform(const b2Vec2 pos, const float angle)
 		wheel->get().SetTransform(pos, angle);
 }
 
-class RayCastCallback : public b2RayCastCallback
+b2Transform Car::body_transform() const
 {
-	public:
-	float ReportFixture(
-		b2Fixture* fixture, [[maybe_unused]] const b2Vec2& point, [[maybe_unused]] const b2Vec2& normal, float fraction)
+	if (_model == VehicleModel::Kinematic)
 	{
-		auto& data = *reinterpret_cast<BodyUserData*>(fixture->GetBody()->GetUserData().pointer);
-		if (data.type == BodyType::BodyWall)
-		{
-			closest_fraction = fraction;
-			return fraction;
-		}
-
-		return -1;
+		return unit->kinematics.transform(unit_index);
 	}
 
-	float closest_fraction = 1.0f;
-};
+	return _body->GetTransform();
+}
 
-void Car::compute_raycasts()
+b2Transform Car::wheel_transform(const std::size_t wheel) const
 {
-	++_ray_update_frequency;
-
-	const size_t ray_count = _rays.size() / 2;
-	const float  radius    = 96.f;
-	for (size_t i = 0; i < ray_count; ++i)
+	if (_model == VehicleModel::Kinematic)
 	{
-		if ((i + _ray_update_frequency) % 2 != 0)
+		const b2Transform xf = body_transform();
+
+		if (wheel >= 2)
 		{
-			continue;
+			return b2Transform{b2Mul(xf, wheel_anchors[wheel]), xf.q};
 		}
 
-		float rad_angle = _body->GetAngle() - _ray_angles[i]/*(i / float(ray_count - 1))*/ * float(M_PI);
+		const auto [c, s] = util::half_turn.rotation(unit->kinematics.steer_angle[unit_index]);
 
-		const b2Vec2 p1 = _body->GetPosition();
-		const b2Vec2 p2 = b2Vec2(p1.x + (cos(rad_angle) * radius), p1.y + (sin(rad_angle) * radius));
+		b2Rot steer;
+		steer.c = c;
+		steer.s = s;
 
-		RayCastCallback raycast;
-		_world.get().RayCast(&raycast, p1, p2);
+		return b2Transform{b2Mul(xf, wheel_anchors[wheel]), b2Mul(xf.q, steer)};
+	}
 
-		// closest_frac = clamp(random_gauss_double(closest_frac, 0.01), 0.0001, 0.999);
+	if (_model == VehicleModel::SingleBody)
+	{
+		const float angle = wheel < 2 ? _steer_angle : 0.0f;
+		return b2Transform{_body->GetWorldPoint(wheel_anchors[wheel]), b2Rot{_body->GetAngle() + angle}};
+	}
 
-		const sf::Color col{
-			static_cast<uint8_t>(util::lerp(200, 0, raycast.closest_fraction)),
-			static_cast<uint8_t>(util::lerp(0, 200, raycast.closest_fraction)),
-			0,
-			static_cast<uint8_t>(util::lerp(150, 0, raycast.closest_fraction))};
+	return _wheels[wheel]->get().GetTransform();
+}
 
-		sf::Vertex v1{sf::Vector2f{p1.x, p1.y}};
-		v1.color     = col;
-		_rays[i * 2] = v1;
+void Car::carry_wheel_mass()
+{
+	_body->ResetMassData();
 
-		b2Vec2     hpoint = p1 + raycast.closest_fraction * (p2 - p1);
-		sf::Vertex v2{sf::Vector2f{hpoint.x, hpoint.y}};
-		v2.color           = col;
-		_rays[(i * 2) + 1] = v2;
+	b2MassData mass;
+	_body->GetMassData(&mass);
 
-		_ray_distances[i] = static_cast<double>(1.f - raycast.closest_fraction);
+	b2Vec2 moment = mass.mass * mass.center;
+
+	for (std::size_t i = 0; i < wheel_anchors.size(); ++i)
+	{
+		const b2Body& wheel_body = _wheels[i]->get();
+		const float   wheel_mass = wheel_body.GetMass();
+
+		mass.mass += wheel_mass;
+		moment += wheel_mass * wheel_anchors[i];
+		// b2MassData::I is about the body origin
+		mass.I += wheel_body.GetInertia() + wheel_mass * wheel_anchors[i].LengthSquared();
 	}
+
+	mass.center = (1.0f / mass.mass) * moment;
+	_body->SetMassData(&mass);
 }
 
-void Car::update_inputs(neural::Network& n)
+void Car::reset(const b2Vec2 pos, const float angle, const VehicleModel model)
 {
-	auto inputs = n.inputs();
+	_model = model;
 
-	assert(inputs.size() == _ray_distances.size() + 4);
+	_world.enable_body(*this);
+	for (Wheel* wheel : _wheels)
+	{
+		if (_model == VehicleModel::Wheeled)
+		{
+			_world.enable_body(*wheel);
+		}
+		else
+		{
+			_world.disable_body(*wheel);
+		}
+	}
 
-	std::size_t i = 0;
+	if (_model != VehicleModel::Wheeled)
+	{
+		carry_wheel_mass();
+	}
+	else
+	{
+		_body->ResetMassData();
+	}
 
-	const auto dir = direction_to_objective();
+	transform(pos, angle);
+	_previous_position = pos;
 
-	// inputs.neurons[i++].value = _net_feedback;
-	inputs[i++].partial_activation = dir.x * 0.5 + 0.5;
-	inputs[i++].partial_activation = dir.y * 0.5 + 0.5;
-	inputs[i++].partial_activation = util::lerp(0.0, 1.0, forward_velocity().Length() / 6.0f);
-	inputs[i++].partial_activation = util::lerp(0.0, 1.0, lateral_velocity().Length() / 1.0f);
+	for (b2Body* body : {_body, &_wheels[0]->get(), &_wheels[1]->get(), &_wheels[2]->get(), &_wheels[3]->get()})
+	{
+		body->SetLinearVelocity({0.0f, 0.0f});
+		body->SetAngularVelocity(0.0f);
+		body->SetAwake(true);
+	}
 
-	for (std::size_t j = 0; j < _ray_distances.size(); ++j, ++i)
+	for (b2RevoluteJoint* joint : _front_joints)
 	{
-		inputs[i].partial_activation = _ray_distances[j];
+		joint->SetLimits(0.0f, 0.0f);
 	}
 
-	/*for (auto& input : inputs)
+	dead = false;
+
+	_reached_checkpoints = 0;
+	_drift_amount        = 0.0f;
+	_brake_amount        = 0.0f;
+	_fitness             = 0.0f;
+	_fitness_bias        = 0.0f;
+	_acceleration_factor = 1.0f;
+	_steer_angle         = 0.0f;
+	_next_steer_angle    = 0.0f;
+
+	_latest_checkpoint = nullptr;
+	_target_checkpoint = nullptr;
+
+	if (_model == VehicleModel::Kinematic)
 	{
-		input.partial_activation += util::random_double(-0.1, 0.1);
-	}*/
+		// CarKinematics moves the car from now on, Box2D only keeps its pose
+		_world.disable_body(*this);
+	}
 }
 } // namespace sim::entities
@@ -5,7 +5,7 @@
 
 namespace sim::entities
 {
-Wheel::Wheel(World& world, const b2BodyDef bdef, const bool do_render) : Body(world, bdef, do_render)
+Wheel::Wheel(World& world, const b2BodyDef bdef) : Body(world, bdef)
 {
 	set_type(BodyType::BodyWheel);
 }
@@ -43,4 +43,55 @@ void Wheel::accelerate(float throttle)
 
 	_body->ApplyForce(final_force * current_fnormal, _body->GetWorldCenter(), true);
 }
+
+namespace
+{
+/// Front and lateral normals of a wheel turned by `angle` on `body`, in world space
+std::pair<b2Vec2, b2Vec2> mounted_normals(const b2Body& body, const float angle)
+{
+	const b2Rot rotation{body.GetAngle() + angle};
+	return {b2Mul(rotation, b2Vec2{0.f, -1.f}), b2Mul(rotation, b2Vec2{1.f, 0.f})};
+}
+} // namespace
+
+void Wheel::cancel_lateral_force(
+	b2Body& body, const b2Vec2 anchor, const float angle, const float mass, const float inertia, const float multiplier)
+{
+	const b2Vec2 point            = body.GetWorldPoint(anchor);
+	const auto [fnormal, lnormal] = mounted_normals(body, angle);
+
+	float  mul     = multiplier * 60.f / 30.0f;
+	b2Vec2 impulse = mass * -(b2Dot(lnormal, body.GetLinearVelocityFromWorldPoint(point)) * lnormal);
+	if (impulse.Length() > (_max_lateral_impulse * mul))
+		impulse *= (_max_lateral_impulse * mul) / impulse.Length();
+
+	body.ApplyLinearImpulse(impulse, point, false);
+	body.ApplyAngularImpulse(_impulse_magnitude * inertia * -body.GetAngularVelocity(), false);
+}
+
+void Wheel::drag(b2Body& body, const b2Vec2 anchor, const float angle, float brake_intensity)
+{
+	const b2Vec2 point            = body.GetWorldPoint(anchor);
+	const auto [fnormal, lnormal] = mounted_normals(body, angle);
+
+	b2Vec2 fvel   = b2Dot(fnormal, body.GetLinearVelocityFromWorldPoint(point)) * fnormal;
+	float  fspeed = fvel.Normalize();
+	float  drag   = util::lerp(_drag, _brake_drag, brake_intensity) * fspeed;
+	body.ApplyForce(drag * fvel, point, false);
+}
+
+void Wheel::accelerate(b2Body& body, const b2Vec2 anchor, const float angle, float throttle)
+{
+	const auto [fnormal, lnormal] = mounted_normals(body, angle);
+
+	float final_force;
+	if (throttle > 0)
+		final_force = _max_accel_force * _forward_mul * std::abs(throttle);
+	else if (throttle < 0)
+		final_force = -_max_accel_force * _backwards_mul * std::abs(throttle);
+	else
+		return;
+
+	body.ApplyForce(final_force * fnormal, body.GetWorldPoint(anchor), true);
+}
 } // namespace sim::entities
@@ -0,0 +1,290 @@
+// built without the precompiled header, see CMakeLists.txt
+#include <carnn/pch.hpp>
+
+#include <carnn/sim/kinematics.hpp>
+
+#include <algorithm>
+#include <array>
+#include <carnn/sim/carstatetable.hpp>
+#include <carnn/sim/entities/car.hpp>
+#include <carnn/sim/entities/wheel.hpp>
+#include <carnn/sim/wallgrid.hpp>
+#include <carnn/util/halfturn.hpp>
+#include <carnn/util/maths.hpp>
+#include <cmath>
+
+namespace sim
+{
+namespace
+{
+// same as b2_maxTranslation and b2_maxRotation, which cap how far a Box2D body moves in a single step
+constexpr float max_translation = 2.0f;
+constexpr float max_rotation    = 0.5f * float(M_PI);
+
+float cross(const float ax, const float ay, const float bx, const float by) { return ax * by - ay * bx; }
+} // namespace
+
+void CarKinematics::load(const std::vector<entities::Car*>& cars)
+{
+	const std::size_t car_count = cars.size();
+
+	for (std::vector<float>* column :
+		 {&position_x,
+		  &position_y,
+		  &rotation_c,
+		  &rotation_s,
+		  &previous_x,
+		  &previous_y,
+		  &velocity_x,
+		  &velocity_y,
+		  &angular_velocity,
+		  &steer_angle,
+		  &drag_x,
+		  &drag_y,
+		  &drag_torque})
+	{
+		column->assign(car_count, 0.0f);
+	}
+
+	moving.assign(car_count, 1.0f);
+	hit_wall.assign(car_count, 0);
+
+	for (std::size_t i = 0; i < car_count; ++i)
+	{
+		const b2Transform& xf = cars[i]->get().GetTransform();
+
+		position_x[i] = previous_x[i] = xf.p.x;
+		position_y[i] = previous_y[i] = xf.p.y;
+		rotation_c[i]                 = xf.q.c;
+		rotation_s[i]                 = xf.q.s;
+	}
+
+	if (car_count == 0)
+	{
+		return;
+	}
+
+	// all the cars are built alike, and were given the wheels' mass by their reset
+	entities::Car& car  = *cars.front();
+	const b2Body&  body = car.get();
+
+	_local_center = body.GetLocalCenter();
+	_mass         = body.GetMass();
+	// b2Body::GetInertia is about the body origin
+	_inertia         = body.GetInertia() - _mass * _local_center.LengthSquared();
+	_wheel_mass      = car.get_wheels().front()->get().GetMass();
+	_wheel_inertia   = car.get_wheels().front()->get().GetInertia();
+	_angular_damping = car.definition().angularDamping;
+}
+
+void CarKinematics::step(
+	const CarStateTable&              state,
+	const std::vector<std::uint32_t>& live_cars,
+	const WallGrid&                   walls,
+	const float                       seconds)
+{
+	// serial: the scheduler already spreads the units over the workers, and a unit only holds a few hundred cars
+	integrate(state, seconds);
+
+	for (const std::uint32_t i : live_cars)
+	{
+		hit_wall[i] = overlaps_wall(i, walls);
+	}
+}
+
+void CarKinematics::integrate(const CarStateTable& state, const float seconds)
+{
+	using entities::Car;
+	using entities::Wheel;
+
+	const float turn_speed     = Car::_turn_speed / 30.0f;
+	const float velocity_scale = seconds / _mass;
+	const float spin_scale     = seconds / _inertia;
+	const float damping        = 1.0f / (1.0f + seconds * _angular_damping);
+	const float lateral_scale  = Wheel::_max_lateral_impulse * 60.f / 30.0f;
+	const float lc_x = _local_center.x, lc_y = _local_center.y;
+	const float mass = _mass, inertia = _inertia, wheel_mass = _wheel_mass, wheel_inertia = _wheel_inertia;
+
+	// wheel anchors relative to the center of mass, in local space
+	std::array<float, 4> anchor_x, anchor_y;
+	for (std::size_t wheel = 0; wheel < anchor_x.size(); ++wheel)
+	{
+		anchor_x[wheel] = Car::wheel_anchors[wheel].x - lc_x;
+		anchor_y[wheel] = Car::wheel_anchors[wheel].y - lc_y;
+	}
+
+	// columns as plain pointers, so that GCC needs not reload them through `this` after every store
+	float* const px = position_x.data();
+	float* const py = position_y.data();
+	float* const rc = rotation_c.data();
+	float* const rs = rotation_s.data();
+	float* const qx = previous_x.data();
+	float* const qy = previous_y.data();
+	float* const vx = velocity_x.data();
+	float* const vy = velocity_y.data();
+	float* const av = angular_velocity.data();
+	float* const sa = steer_angle.data();
+	float* const dx = drag_x.data();
+	float* const dy = drag_y.data();
+	float* const dt = drag_torque.data();
+
+	const float* const mv = moving.data();
+
+	const float* const throttles = state.throttle.data();
+	const float* const steerings = state.steering.data();
+	const float* const brakes    = state.brake.data();
+	const float* const drifts    = state.drift.data();
+
+	// the columns never overlap, which would otherwise take more runtime alias checks than compilers are willing to add
+#if defined(__clang__)
+#pragma clang loop vectorize(assume_safety)
+#elif defined(__GNUC__)
+#pragma GCC ivdep
+#endif
+	for (std::size_t i = 0, end = size(); i < end; ++i)
+	{
+		// everything is read up front and written back at the end, so that masking out frozen cars is a plain select
+		const float x = px[i], y = py[i], c = rc[i], s = rs[i];
+		const float old_vx = vx[i], old_vy = vy[i], old_w = av[i], old_steer = sa[i];
+		const float old_drag_x = dx[i], old_drag_y = dy[i], old_drag_torque = dt[i];
+		const float old_previous_x = qx[i], old_previous_y = qy[i];
+
+		const float center_x = x + c * lc_x - s * lc_y;
+		const float center_y = y + s * lc_x + c * lc_y;
+
+		float force_x = old_drag_x, force_y = old_drag_y, torque = old_drag_torque;
+
+		// drive, from the front wheels as turned before this step
+		const float throttle  = throttles[i];
+		const float magnitude = Wheel::_max_accel_force * throttle
+			* (throttle > 0.0f ? Wheel::_forward_mul : Wheel::_backwards_mul);
+
+		const auto [steer_c, steer_s] = util::half_turn.rotation(old_steer);
+		const float drive_c = c * steer_c - s * steer_s, drive_s = s * steer_c + c * steer_s;
+		const float drive_x = drive_s * magnitude, drive_y = -drive_c * magnitude;
+
+		for (std::size_t wheel = 0; wheel < 2; ++wheel)
+		{
+			const float rx = c * anchor_x[wheel] - s * anchor_y[wheel];
+			const float ry = s * anchor_x[wheel] + c * anchor_y[wheel];
+
+			force_x += drive_x;
+			force_y += drive_y;
+			torque += cross(rx, ry, drive_x, drive_y);
+		}
+
+		// steering, which like a joint limit only takes effect over the step
+		const float desired_angle = util::lerp(-Car::_angle_lock, Car::_angle_lock, steerings[i] * 0.5f + 0.5f);
+		const float steer = old_steer + util::clamp(desired_angle - old_steer, -turn_speed, turn_speed);
+
+		// velocities then positions, as b2Island::Solve does
+		float nvx = old_vx + velocity_scale * force_x;
+		float nvy = old_vy + velocity_scale * force_y;
+		float nw  = (old_w + spin_scale * torque) * damping;
+
+		const float translation       = seconds * std::sqrt(nvx * nvx + nvy * nvy);
+		const float translation_scale = util::clamp(max_translation / (translation + 1.0e-30f), 0.0f, 1.0f);
+		nvx *= translation_scale;
+		nvy *= translation_scale;
+
+		const float rotation = std::abs(seconds * nw);
+		nw *= util::clamp(max_rotation / (rotation + 1.0e-30f), 0.0f, 1.0f);
+
+		// rotate by the step's angle, renormalizing to first order so that the rotation never drifts off unit length
+		const auto [turn_c, turn_s] = util::half_turn.rotation(seconds * nw);
+		float       nc = c * turn_c - s * turn_s, ns = s * turn_c + c * turn_s;
+		const float renormalize = 1.5f - 0.5f * (nc * nc + ns * ns);
+		nc *= renormalize;
+		ns *= renormalize;
+
+		const float nx = center_x + seconds * nvx - (nc * lc_x - ns * lc_y);
+		const float ny = center_y + seconds * nvy - (ns * lc_x + nc * lc_y);
+
+		// tire impulses and drag, with the wheels turned as asked for this step
+		const float max_impulse = lateral_scale * util::lerp(1.f, 0.1f, drifts[i]);
+		const float drag        = util::lerp(Wheel::_drag, Wheel::_brake_drag, brakes[i]);
+
+		const auto [wheel_steer_c, wheel_steer_s] = util::half_turn.rotation(steer);
+		const float front_c = nc * wheel_steer_c - ns * wheel_steer_s, front_s = ns * wheel_steer_c + nc * wheel_steer_s;
+
+		float next_force_x = 0.0f, next_force_y = 0.0f, next_torque = 0.0f;
+
+		for (std::size_t wheel = 0; wheel < Car::wheel_anchors.size(); ++wheel)
+		{
+			const float rx = nc * anchor_x[wheel] - ns * anchor_y[wheel];
+			const float ry = ns * anchor_x[wheel] + nc * anchor_y[wheel];
+
+			const float wc = wheel < 2 ? front_c : nc, ws = wheel < 2 ? front_s : ns;
+
+			// lateral cancellation, see Wheel::cancel_lateral_force
+			const float lateral = wc * (nvx - nw * ry) + ws * (nvy + nw * rx);
+			const float impulse = util::clamp(-wheel_mass * lateral, -max_impulse, max_impulse);
+
+			nvx += impulse * wc / mass;
+			nvy += impulse * ws / mass;
+			nw += cross(rx, ry, impulse * wc, impulse * ws) / inertia;
+			nw += Wheel::_impulse_magnitude * wheel_inertia * -nw / inertia;
+
+			// drag, see Wheel::drag
+			const float forward = ws * (nvx - nw * ry) - wc * (nvy + nw * rx);
+			const float fx = drag * forward * ws, fy = drag * forward * -wc;
+
+			next_force_x += fx;
+			next_force_y += fy;
+			next_torque += cross(rx, ry, fx, fy);
+		}
+
+		// frozen cars keep their state
+		const bool live = mv[i] != 0.0f;
+
+		qx[i] = live ? x : old_previous_x;
+		qy[i] = live ? y : old_previous_y;
+		px[i] = live ? nx : x;
+		py[i] = live ? ny : y;
+		rc[i] = live ? nc : c;
+		rs[i] = live ? ns : s;
+		vx[i] = live ? nvx : old_vx;
+		vy[i] = live ? nvy : old_vy;
+		av[i] = live ? nw : old_w;
+		sa[i] = live ? steer : old_steer;
+		dx[i] = live ? next_force_x : old_drag_x;
+		dy[i] = live ? next_force_y : old_drag_y;
+		dt[i] = live ? next_torque : old_drag_torque;
+	}
+}
+
+bool CarKinematics::overlaps_wall(const std::size_t i, const WallGrid& walls) const
+{
+	const b2Transform xf = transform(i);
+
+	// sweep of the origin, in case a wall got between two outlines
+	const b2Vec2 origin{position_x[i], position_y[i]}, previous{previous_x[i], previous_y[i]};
+	if (walls.raycast(previous, origin - previous) < 1.0f)
+	{
+		return true;
+	}
+
+	const auto& vertices = entities::Car::body_vertices;
+
+	for (std::size_t v = 0; v < vertices.size(); ++v)
+	{
+		const b2Vec2 p1 = b2Mul(xf, vertices[v]), p2 = b2Mul(xf, vertices[(v + 1) % vertices.size()]);
+
+		if (walls.raycast(p1, p2 - p1) < 1.0f)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+b2Transform CarKinematics::transform(const std::size_t car) const
+{
+	b2Transform xf;
+	xf.p   = {position_x[car], position_y[car]};
+	xf.q.c = rotation_c[car];
+	xf.q.s = rotation_s[car];
+	return xf;
+}
+} // namespace sim
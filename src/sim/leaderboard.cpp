@@ -0,0 +1,36 @@
+#include <carnn/sim/leaderboard.hpp>
+
+#include <algorithm>
+#include <carnn/sim/entities/car.hpp>
+
+namespace sim
+{
+Leaderboard::Leaderboard(const std::size_t capacity) : _capacity(capacity) { _entries.reserve(capacity); }
+
+void Leaderboard::update(const std::vector<entities::Car*>& cars)
+{
+	// min-heap on fitness, so that the worst of the current top is at the front
+	const auto better = [](const Entry& a, const Entry& b) { return a.fitness > b.fitness; };
+
+	_entries.clear();
+
+	for (entities::Car* car : cars)
+	{
+		const float fitness = car->fitness();
+
+		if (_entries.size() < _capacity)
+		{
+			_entries.push_back({fitness, car});
+			std::push_heap(_entries.begin(), _entries.end(), better);
+		}
+		else if (fitness > _entries.front().fitness)
+		{
+			std::pop_heap(_entries.begin(), _entries.end(), better);
+			_entries.back() = {fitness, car};
+			std::push_heap(_entries.begin(), _entries.end(), better);
+		}
+	}
+
+	std::sort_heap(_entries.begin(), _entries.end(), better);
+}
+} // namespace sim
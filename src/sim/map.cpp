@@ -0,0 +1,175 @@
+#include <carnn/sim/map.hpp>
+
+#include <carnn/sim/distancefield.hpp>
+#include <carnn/sim/wallgrid.hpp>
+#include <carnn/sim/world.hpp>
+#include <fstream>
+#include <json/reader.h>
+#include <json/value.h>
+#include <spdlog/spdlog.h>
+#include <tuple>
+
+namespace sim
+{
+std::shared_ptr<const Map> Map::load(const MapSettings& settings)
+{
+	static std::mutex mutex;
+	static std::map<std::tuple<std::string, std::string, bool>, std::shared_ptr<const Map>> cache;
+
+	std::lock_guard lock{mutex};
+
+	auto& map = cache[{settings.map_path, settings.checkpoint_path, settings.flip}];
+	if (map == nullptr)
+	{
+		map = std::make_shared<Map>(settings);
+	}
+
+	return map;
+}
+
+Map::Map(MapSettings settings) : settings(settings)
+{
+	load_walls();
+	load_checkpoints();
+
+	wall_grid = std::make_unique<WallGrid>(walls);
+}
+
+std::shared_ptr<const DistanceField> Map::distance_field(float resolution) const
+{
+	std::lock_guard lock{_distance_fields_mutex};
+
+	auto& field = _distance_fields[resolution];
+	if (field == nullptr)
+	{
+		field = std::make_shared<DistanceField>(walls, resolution);
+	}
+
+	return field;
+}
+
+void Map::load_walls()
+{
+	const char* fname = settings.map_path.c_str();
+
+	spdlog::info("loading bitmap from file '{}'", fname);
+
+	sf::Image map;
+	if (!map.loadFromFile(fname))
+	{
+		return;
+	}
+
+	const float flip_mul = settings.flip ? -1.0 : 1.0f;
+
+	sf::Vector2u image_size = map.getSize();
+	for (unsigned y = 1; y < image_size.y - 1; ++y)
+	{
+		for (unsigned x = 1; x < image_size.x - 1; ++x)
+		{
+			const sf::Color main_pixel = map.getPixel(x, y);
+			if (main_pixel == sf::Color::White)
+			{
+				for (unsigned yn = y - 1; yn < y + 2; ++yn)
+					for (unsigned xn = x - 1; xn < x + 2; ++xn)
+					{
+						if (xn == x && yn == y)
+						{
+							continue;
+						}
+
+						util::Line ln{{x * World::scale, y * World::scale}, {xn * World::scale, yn * World::scale}};
+
+						ln.p1.x *= flip_mul;
+						ln.p2.x *= flip_mul;
+
+						const sf::Color pixel = map.getPixel(xn, yn);
+						if (pixel == sf::Color::White)
+						{
+							if (std::find(begin(walls), end(walls), ln) == end(walls))
+							{
+								wall_vertices.emplace_back(ln.p1, sf::Color::White);
+								wall_vertices.emplace_back(ln.p2, sf::Color::White);
+
+								walls.push_back(ln);
+							}
+						}
+					}
+			}
+			else if (main_pixel.b == 255)
+			{
+				car_origin = {x * flip_mul * World::scale, y * World::scale};
+			}
+		}
+	}
+}
+
+void Map::load_checkpoints()
+{
+	const char* fname = settings.checkpoint_path.c_str();
+	const float flip_mul = settings.flip ? -1.0 : 1.0f;
+
+	spdlog::info("loading checkpoints from file '{}'", fname);
+
+	std::ifstream           race_config{fname, std::ios::binary};
+	Json::Value             root;
+	Json::CharReaderBuilder reader;
+	Json::parseFromStream(reader, race_config, &root, nullptr);
+
+	checkpoint_vertices = sf::VertexArray(sf::Lines);
+
+	for (const Json::Value& cp : root["checkpoints"])
+	{
+		sf::Vector2f p1{
+			cp["p1"].get(Json::ArrayIndex{0}, 0).asFloat() * 5.f,
+			cp["p1"].get(Json::ArrayIndex{1}, 0).asFloat() * 5.f},
+			p2{cp["p2"].get(Json::ArrayIndex{0}, 0).asFloat() * 5.f,
+			   cp["p2"].get(Json::ArrayIndex{1}, 0).asFloat() * 5.f};
+
+		sf::Vector2f center{p1 + (p2 - p1) / 2.f};
+
+		// Extend the line by 5 pixels each side
+		p1.x += (p1.x > center.x) ? 5.f : -5.f; // @todo compact if possible
+		p2.x += (p2.x > center.x)
+			? 5.f
+			: -5.f; // for (float& x : {p1.x, p2.x} doesn't work since you can't get a reference to both
+		p1.y += (p1.y > center.y) ? 5.f : -5.f;
+		p2.y += (p2.y > center.y) ? 5.f : -5.f;
+
+		p1.x *= flip_mul;
+		p2.x *= flip_mul;
+
+		const static sf::Color cp_col{0, 127, 0, 100};
+
+		checkpoint_vertices.append(sf::Vertex{p1, cp_col});
+		checkpoint_vertices.append(sf::Vertex{p2, cp_col});
+
+		checkpoints.push_back({center, p1, p2, {}, {}});
+	}
+
+	if (settings.flip)
+	{
+		std::reverse(checkpoints.begin(), checkpoints.end());
+	}
+
+	measure_checkpoints();
+}
+
+void Map::measure_checkpoints()
+{
+	const std::size_t count = checkpoints.size();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const CheckpointLine& previous = checkpoints[(i + count - 1) % count];
+		CheckpointLine&       current  = checkpoints[i];
+
+		const sf::Vector2f from = (previous.p1 + previous.p2) / 2.0f, to = (current.p1 + current.p2) / 2.0f;
+		const sf::Vector2f span         = to - from;
+		const float        span_squared = span.x * span.x + span.y * span.y;
+
+		current.progress_origin = from;
+		current.progress_axis   = span_squared > 0.0f ? span / span_squared : sf::Vector2f{};
+	}
+}
+} // namespace sim
@@ -0,0 +1,132 @@
+#include <carnn/sim/placement.hpp>
+
+#include <sched.h>
+#include <spdlog/spdlog.h>
+
+namespace sim
+{
+/// Pins the threads entering an arena to the CPUs of a node, restoring their previous affinity when they leave it,
+/// since TBB workers move between arenas.
+class Placement::PinningObserver : public tbb::task_scheduler_observer
+{
+	public:
+	PinningObserver(tbb::task_arena& arena, const std::vector<int>& cpus) : tbb::task_scheduler_observer(arena)
+	{
+#ifdef __linux__
+		CPU_ZERO(&_cpus);
+
+		for (const int cpu : cpus)
+		{
+			CPU_SET(cpu, &_cpus);
+		}
+#endif
+
+		observe(true);
+	}
+
+	~PinningObserver() override { observe(false); }
+
+	void on_scheduler_entry(bool) override
+	{
+#ifdef __linux__
+		sched_getaffinity(0, sizeof(previous_cpus()), &previous_cpus());
+
+		if (sched_setaffinity(0, sizeof(_cpus), &_cpus) != 0)
+		{
+			spdlog::warn("failed to pin a simulation thread to its NUMA node");
+		}
+#endif
+	}
+
+	void on_scheduler_exit(bool) override
+	{
+#ifdef __linux__
+		sched_setaffinity(0, sizeof(previous_cpus()), &previous_cpus());
+#endif
+	}
+
+	private:
+#ifdef __linux__
+	static cpu_set_t& previous_cpus()
+	{
+		thread_local cpu_set_t cpus;
+		return cpus;
+	}
+
+	cpu_set_t _cpus;
+#endif
+};
+
+Placement::Placement(const Topology& topology, std::size_t thread_count)
+{
+	if (thread_count == 0)
+	{
+		thread_count = std::max<std::size_t>(1, topology.core_count - 1);
+	}
+
+	std::vector<NumaNode> numa_nodes = topology.nodes;
+
+	if (numa_nodes.empty())
+	{
+		numa_nodes.resize(1);
+	}
+
+	const bool pin = numa_nodes.size() > 1;
+
+	std::size_t cpu_count = 0;
+
+	for (const NumaNode& numa_node : numa_nodes)
+	{
+		cpu_count += std::max<std::size_t>(1, numa_node.cpus.size());
+	}
+
+	// workers are shared by all arenas, and TBB only spawns one less than the core count by default. every node
+	// getting at least one thread, there are at most that many.
+	_parallelism = std::make_unique<tbb::global_control>(
+		tbb::global_control::max_allowed_parallelism,
+		std::max(
+			std::max(thread_count, numa_nodes.size()) + 1,
+			tbb::global_control::active_value(tbb::global_control::max_allowed_parallelism)));
+
+	std::size_t cpus_before = 0, threads_before = 0;
+
+	for (const NumaNode& numa_node : numa_nodes)
+	{
+		// hand threads out in proportion to the CPUs of each node, every node getting at least one
+		cpus_before += std::max<std::size_t>(1, numa_node.cpus.size());
+		const std::size_t threads_after = std::max(threads_before + 1, thread_count * cpus_before / cpu_count);
+
+		auto node          = std::make_unique<Node>();
+		node->thread_count = threads_after - threads_before;
+		node->arena        = std::make_unique<tbb::task_arena>(int(node->thread_count), 0);
+
+		if (pin)
+		{
+			node->pinning = std::make_unique<PinningObserver>(*node->arena, numa_node.cpus);
+		}
+
+		threads_before = threads_after;
+		_nodes.push_back(std::move(node));
+	}
+
+	_thread_count = threads_before;
+
+	spdlog::info("running the simulation on {} threads over {} NUMA nodes", _thread_count, _nodes.size());
+}
+
+Placement::~Placement() = default;
+
+std::pair<std::size_t, std::size_t> Placement::unit_range(const std::size_t node, const std::size_t unit_count) const
+{
+	std::size_t threads_before = 0;
+
+	for (std::size_t i = 0; i < node; ++i)
+	{
+		threads_before += _nodes[i]->thread_count;
+	}
+
+	const std::size_t threads_after = threads_before + _nodes[node]->thread_count;
+
+	return {unit_count * threads_before / _thread_count, unit_count * threads_after / _thread_count};
+}
+} // namespace sim
@@ -0,0 +1,113 @@
+#include <carnn/sim/raybatch.hpp>
+
+#include <algorithm>
+#include <carnn/sim/carstatetable.hpp>
+#include <carnn/sim/wallgrid.hpp>
+
+namespace sim
+{
+void RayBatch::clear()
+{
+	_origin_x.clear();
+	_origin_y.clear();
+	_delta_x.clear();
+	_delta_y.clear();
+	_fractions.clear();
+	_cars.clear();
+	_rays.clear();
+	_cell_rays.clear();
+}
+
+void RayBatch::reserve(const std::size_t ray_count)
+{
+	_origin_x.reserve(ray_count);
+	_origin_y.reserve(ray_count);
+	_delta_x.reserve(ray_count);
+	_delta_y.reserve(ray_count);
+	_fractions.reserve(ray_count);
+	_cars.reserve(ray_count);
+	_rays.reserve(ray_count);
+}
+
+void RayBatch::add(const std::uint32_t car, const std::uint32_t ray, const b2Vec2 p1, const b2Vec2 p2)
+{
+	_origin_x.push_back(p1.x);
+	_origin_y.push_back(p1.y);
+	_delta_x.push_back(p2.x - p1.x);
+	_delta_y.push_back(p2.y - p1.y);
+	_cars.push_back(car);
+	_rays.push_back(ray);
+}
+
+void RayBatch::cast(const WallGrid& grid, CarStateTable& state)
+{
+	_fractions.assign(size(), 1.0f);
+
+	// the cells every ray goes through, leaving out the ones without walls
+	_cell_rays.clear();
+
+	for (std::uint32_t i = 0; i < size(); ++i)
+	{
+		grid.walk({_origin_x[i], _origin_y[i]}, {_delta_x[i], _delta_y[i]}, [&](const std::size_t cell, float) {
+			if (grid.segment_count(cell) != 0)
+			{
+				_cell_rays.push_back(std::uint64_t(cell) << 32 | i);
+			}
+
+			return true;
+		});
+	}
+
+	std::sort(_cell_rays.begin(), _cell_rays.end());
+
+	// every ray ends up with the closest hit over all the cells it goes through, which is what WallGrid::raycast finds
+	// by stopping at the first cell holding a hit
+	for (std::size_t begin = 0, end = 0; begin < _cell_rays.size(); begin = end)
+	{
+		const std::uint64_t cell = _cell_rays[begin] >> 32;
+
+		end = begin;
+		while (end < _cell_rays.size() && _cell_rays[end] >> 32 == cell)
+		{
+			++end;
+		}
+
+		const std::size_t count = end - begin;
+
+		for (auto* lane : {&_lane_origin_x, &_lane_origin_y, &_lane_delta_x, &_lane_delta_y, &_lane_closest})
+		{
+			lane->resize(std::max(lane->size(), count));
+		}
+
+		for (std::size_t j = 0; j < count; ++j)
+		{
+			const auto i = std::uint32_t(_cell_rays[begin + j]);
+
+			_lane_origin_x[j] = _origin_x[i];
+			_lane_origin_y[j] = _origin_y[i];
+			_lane_delta_x[j]  = _delta_x[i];
+			_lane_delta_y[j]  = _delta_y[i];
+			_lane_closest[j]  = _fractions[i];
+		}
+
+		grid.closest_in_cell(
+			std::size_t(cell),
+			{_lane_origin_x.data(),
+			 _lane_origin_y.data(),
+			 _lane_delta_x.data(),
+			 _lane_delta_y.data(),
+			 _lane_closest.data(),
+			 count});
+
+		for (std::size_t j = 0; j < count; ++j)
+		{
+			_fractions[std::uint32_t(_cell_rays[begin + j])] = _lane_closest[j];
+		}
+	}
+
+	for (std::size_t i = 0; i < size(); ++i)
+	{
+		state.set_ray_result(_cars[i], _rays[i], _fractions[i]);
+	}
+}
+} // namespace sim
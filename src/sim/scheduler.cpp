@@ -0,0 +1,199 @@
+#include <carnn/sim/scheduler.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <carnn/sim/placement.hpp>
+#include <carnn/sim/simulationunit.hpp>
+#include <tbb/tbb.h>
+#include <tuple>
+
+namespace sim
+{
+/// The flow graph of the staged pipeline for one NUMA node. A group is only ever in a single stage at a time, so the
+/// nodes may run any number of groups concurrently without two threads touching the same unit.
+class Scheduler::Pipeline
+{
+	public:
+	Pipeline() :
+		_sense(_graph, tbb::flow::unlimited, [](UnitGroup* group) { return run_stage(&TickStages::sense, group); }),
+		_infer(_graph, tbb::flow::unlimited, [](UnitGroup* group) { return run_stage(&TickStages::infer, group); }),
+		_act(_graph, tbb::flow::unlimited, [](UnitGroup* group, ActNode::output_ports_type& ports) {
+			run_stage(&TickStages::act, group);
+
+			const bool running = std::any_of(group->units.begin(), group->units.end(), [&](const SimulationUnit* unit) {
+				return unit->seconds_elapsed <= group->max_seconds;
+			});
+
+			// around again for the next tick
+			if (++group->ticks < group->batch_ticks && running)
+			{
+				std::get<0>(ports).try_put(group);
+			}
+		})
+	{
+		tbb::flow::make_edge(_sense, _infer);
+		tbb::flow::make_edge(_infer, _act);
+		tbb::flow::make_edge(tbb::flow::output_port<0>(_act), _sense);
+	}
+
+	/// Takes every group through its ticks, returning once they are all done
+	void run(std::vector<UnitGroup>& groups)
+	{
+		for (UnitGroup& group : groups)
+		{
+			if (group.batch_ticks != 0)
+			{
+				_sense.try_put(&group);
+			}
+		}
+
+		_graph.wait_for_all();
+	}
+
+	private:
+	using StageNode = tbb::flow::function_node<UnitGroup*, UnitGroup*>;
+	using ActNode   = tbb::flow::multifunction_node<UnitGroup*, std::tuple<UnitGroup*>>;
+
+	/// The clock of a unit only moves in `act`, so all the stages of a tick agree on whether the unit still runs
+	static UnitGroup* run_stage(std::function<void(SimulationUnit&)> TickStages::*stage, UnitGroup* group)
+	{
+		const auto& run = group->stages->*stage;
+
+		for (SimulationUnit* unit : group->units)
+		{
+			if (unit->seconds_elapsed <= group->max_seconds)
+			{
+				run(*unit);
+			}
+		}
+
+		return group;
+	}
+
+	/// Declared first, so that the nodes go away before it
+	tbb::flow::graph _graph;
+
+	StageNode _sense, _infer;
+	ActNode   _act;
+};
+
+Scheduler::Scheduler() = default;
+
+Scheduler::~Scheduler() = default;
+
+void Scheduler::advance(Simulation& sim, const std::size_t ticks, const float max_seconds, const TickStages& stages)
+{
+	Placement& placement = *sim.placement;
+
+	_queues.resize(placement.node_count());
+
+	for (std::size_t node = 0; node < placement.node_count(); ++node)
+	{
+		std::vector<SimulationUnit*>& queue = _queues[node];
+		queue.clear();
+
+		const auto range = placement.unit_range(node, sim.units.size());
+
+		for (std::size_t i = range.first; i < range.second; ++i)
+		{
+			SimulationUnit& unit = sim.units[i];
+
+			if (unit.live_car_count() != 0)
+			{
+				queue.push_back(&unit);
+				continue;
+			}
+
+			for (std::size_t tick = 0; tick < ticks && unit.seconds_elapsed <= max_seconds; ++tick)
+			{
+				unit.advance_clock();
+			}
+		}
+
+		std::sort(queue.begin(), queue.end(), [](const SimulationUnit* a, const SimulationUnit* b) {
+			return estimated_cost(*a) > estimated_cost(*b);
+		});
+	}
+
+	if (sim.simulation_settings.tick_pipeline == TickPipeline::Staged)
+	{
+		const auto group_size = std::size_t(std::max(sim.simulation_settings.unit_group_size, 1));
+
+		_groups.resize(placement.node_count());
+
+		for (std::size_t node = 0; node < placement.node_count(); ++node)
+		{
+			const std::vector<SimulationUnit*>& queue  = _queues[node];
+			std::vector<UnitGroup>&             groups = _groups[node];
+
+			// dealt like cards, so that every group gets its share of the heavy units
+			groups.resize((queue.size() + group_size - 1) / group_size);
+
+			for (UnitGroup& group : groups)
+			{
+				group.units.clear();
+				group.ticks       = 0;
+				group.batch_ticks = ticks;
+				group.max_seconds = max_seconds;
+				group.stages      = &stages;
+			}
+
+			for (std::size_t i = 0; i < queue.size(); ++i)
+			{
+				groups[i % groups.size()].units.push_back(queue[i]);
+			}
+		}
+
+		_pipelines.resize(placement.node_count());
+
+		placement.for_each_node([&](const std::size_t node) { advance_staged(node); });
+	}
+	else
+	{
+		placement.for_each_node([&](const std::size_t node) { advance_per_unit(node, ticks, max_seconds, stages); });
+	}
+}
+
+std::size_t Scheduler::estimated_cost(const SimulationUnit& unit) { return unit.live_car_count() + 1; }
+
+void Scheduler::advance_per_unit(
+	const std::size_t node,
+	const std::size_t ticks,
+	const float       max_seconds,
+	const TickStages& stages)
+{
+	const std::vector<SimulationUnit*>& queue = _queues[node];
+
+	std::atomic<std::size_t> next_unit{0};
+
+	const auto worker_count = std::size_t(tbb::this_task_arena::max_concurrency());
+
+	tbb::parallel_for(
+		tbb::blocked_range<std::size_t>(0, std::min(worker_count, queue.size()), 1),
+		[&](const auto&) {
+			for (std::size_t i = next_unit++; i < queue.size(); i = next_unit++)
+			{
+				SimulationUnit& unit = *queue[i];
+
+				for (std::size_t tick = 0; tick < ticks && unit.seconds_elapsed <= max_seconds; ++tick)
+				{
+					stages.sense(unit);
+					stages.infer(unit);
+					stages.act(unit);
+				}
+			}
+		},
+		tbb::simple_partitioner());
+}
+
+void Scheduler::advance_staged(const std::size_t node)
+{
+	// built from the arena of the node, which the graph then runs its tasks in
+	if (_pipelines[node] == nullptr)
+	{
+		_pipelines[node] = std::make_unique<Pipeline>();
+	}
+
+	_pipelines[node]->run(_groups[node]);
+}
+} // namespace sim
@@ -0,0 +1,84 @@
+#include <carnn/sim/settings.hpp>
+
+#include <algorithm>
+#include <cereal/archives/json.hpp>
+#include <fstream>
+#include <spdlog/spdlog.h>
+
+namespace sim
+{
+bool SimulationSettings::load_from_file()
+{
+	spdlog::info("reloading simulation settings from file");
+
+	try
+	{
+		std::ifstream            is("simulation.json", std::ios::binary);
+		cereal::JSONInputArchive ar(is);
+		serialize(ar);
+	}
+	catch (const cereal::Exception& e)
+	{
+		spdlog::error("exception occured while loading simulation settings: {}", e.what());
+		sanitize();
+		return false;
+	}
+
+	sanitize();
+	return true;
+}
+
+bool SimulationSettings::save()
+{
+	spdlog::info("saving simulation settings to file");
+
+	std::ofstream             os("simulation.json", std::ios::binary);
+	cereal::JSONOutputArchive ar(os);
+	serialize(ar);
+	return true;
+}
+
+void SimulationSettings::load_defaults() { *this = {}; }
+
+void SimulationSettings::sanitize()
+{
+	const SimulationSettings defaults;
+
+	// enums are read from the file as plain integers
+	if (raycast_method >= RaycastMethod::Total)
+	{
+		raycast_method = defaults.raycast_method;
+	}
+
+	if (ray_schedule >= RaySchedule::Total)
+	{
+		ray_schedule = defaults.ray_schedule;
+	}
+
+	if (vehicle_model >= VehicleModel::Total)
+	{
+		vehicle_model = defaults.vehicle_model;
+	}
+
+	if (tick_pipeline >= TickPipeline::Total)
+	{
+		tick_pipeline = defaults.tick_pipeline;
+	}
+
+	ray_count       = std::clamp(ray_count, 1, 64);
+	ray_period      = std::max(ray_period, 1);
+	control_period  = std::max(control_period, 1);
+	unit_group_size = std::max(unit_group_size, 1);
+
+	// written so that NaN falls back to the smallest resolution too
+	if (!(distance_field_resolution >= 0.1f))
+	{
+		distance_field_resolution = 0.1f;
+	}
+
+	population_size = std::max(population_size, 1);
+	// more units than cars would only build empty worlds
+	unit_count   = std::clamp(unit_count, 0, population_size);
+	thread_count = std::max(thread_count, 0);
+}
+} // namespace sim
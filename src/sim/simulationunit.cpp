@@ -1,201 +1,354 @@
 #include <carnn/sim/simulationunit.hpp>
 
+#include <algorithm>
 #include <carnn/sim/entities/car.hpp>
 #include <carnn/sim/entities/checkpoint.hpp>
+#include <carnn/sim/individual.hpp>
 #include <carnn/sim/world.hpp>
 #include <carnn/util/line.hpp>
-#include <fstream>
-#include <json/reader.h>
-#include <json/value.h>
 #include <spdlog/spdlog.h>
-#include <thread>
 
 namespace sim
 {
-Simulation::Simulation(MapSettings settings) :
-	settings(settings),
-	units(24*32)
+namespace
 {
-	spdlog::info("reinitializing simulation");
-	load_map();
-	load_checkpoints();
-	init_cars();
-}
+class RayCastCallback : public b2RayCastCallback
+{
+	public:
+	float ReportFixture(
+		b2Fixture* fixture, [[maybe_unused]] const b2Vec2& point, [[maybe_unused]] const b2Vec2& normal, float fraction)
+	{
+		auto& data = *reinterpret_cast<entities::BodyUserData*>(fixture->GetBody()->GetUserData().pointer);
+		if (data.type == entities::BodyType::BodyWall)
+		{
+			closest_fraction = fraction;
+			return fraction;
+		}
+
+		return -1;
+	}
+
+	float closest_fraction = 1.0f;
+};
+} // namespace
 
-void Simulation::load_map()
+void SimulationUnit::compute_raycasts()
 {
-	const char* fname = settings.map_path.c_str();
+	++state.ray_ticks;
 
-	spdlog::info("loading bitmap from file '{}'", fname);
+	std::size_t rays_cast = 0;
 
-	sf::Image map;
-	if (!map.loadFromFile(fname))
+	if (raycast_method == RaycastMethod::Batched)
 	{
-		return;
+		ray_batch.clear();
 	}
 
-	for (auto& unit : units)
+	for (const std::uint32_t car_index : live_cars)
 	{
-		b2BodyDef bdef;
-		bdef.type = b2_staticBody;
-		unit.wall = &unit.world.add_body(bdef);
-		unit.wall->set_type(sim::entities::BodyType::BodyWall);
-	}
+		for (std::uint32_t ray = 0; ray < state.ray_count(); ++ray)
+		{
+			if (!state.ray_due(car_index, ray))
+			{
+				continue;
+			}
 
-	const float flip_mul = settings.flip ? -1.0 : 1.0f;
+			++rays_cast;
 
-	std::vector<util::Line> eliminated;
-	sf::Vector2u            image_size = map.getSize();
-	for (unsigned y = 1; y < image_size.y - 1; ++y)
-	{
-		for (unsigned x = 1; x < image_size.x - 1; ++x)
-		{
-			const sf::Color main_pixel = map.getPixel(x, y);
-			if (main_pixel == sf::Color::White)
+			const auto [p1, p2] = state.ray_segment(car_index, ray);
+
+			switch (raycast_method)
 			{
-				for (unsigned yn = y - 1; yn < y + 2; ++yn)
-					for (unsigned xn = x - 1; xn < x + 2; ++xn)
-					{
-						if (xn == x && yn == y)
-						{
-							continue;
-						}
+			case RaycastMethod::Batched:
+			{
+				ray_batch.add(car_index, ray, p1, p2);
+				break;
+			}
 
-						util::Line ln{{x * World::scale, y * World::scale}, {xn * World::scale, yn * World::scale}};
+			case RaycastMethod::DistanceField:
+			{
+				state.set_ray_result(car_index, ray, distance_field->raycast(p1, p2));
+				break;
+			}
 
-						ln.p1.x *= flip_mul;
-						ln.p2.x *= flip_mul;
+			case RaycastMethod::Exact:
+			default:
+			{
+				RayCastCallback raycast;
+				world.get().RayCast(&raycast, p1, p2);
+				state.set_ray_result(car_index, ray, raycast.closest_fraction);
+				break;
+			}
+			}
+		}
+	}
 
-						const sf::Color pixel = map.getPixel(xn, yn);
-						if (pixel == sf::Color::White)
-						{
-							if (std::find(begin(eliminated), end(eliminated), ln) == end(eliminated))
-							{
+	if (raycast_method == RaycastMethod::Batched)
+	{
+		ray_batch.cast(*wall_grid, state);
+	}
+
+	profile.rays_cast += rays_cast;
+}
+
+void SimulationUnit::step(const float seconds)
+{
+	if (vehicle_model != VehicleModel::Kinematic)
+	{
+		world.step(seconds, 1, 1).update();
+		return;
+	}
 
-								b2EdgeShape wall_shape;
-								wall_shape.SetTwoSided({ln.p1.x, ln.p1.y}, {ln.p2.x, ln.p2.y});
+	kinematics.step(state, live_cars, *wall_grid, seconds);
 
-								b2FixtureDef fixdef;
-								fixdef.shape = &wall_shape;
+	// what the wall listener and World::update do for Box2D cars, without touching the disabled Box2D bodies. Backwards,
+	// since dead cars get swap-removed.
+	for (std::size_t slot = live_cars.size(); slot-- > 0;)
+	{
+		const std::uint32_t car_index = live_cars[slot];
+		entities::Car&      car       = *cars[car_index];
 
-								for (auto& unit : units)
-								{
-									unit.wall->add_fixture(fixdef);
-								}
+		if (kinematics.hit_wall[car_index])
+		{
+			car.wall_collision();
+		}
 
-								wall_vertices.emplace_back(ln.p1, sf::Color::White);
-								wall_vertices.emplace_back(ln.p2, sf::Color::White);
+		car.update();
 
-								eliminated.push_back(ln);
-							}
-						}
-					}
-			}
-			else if (main_pixel.b == 255)
-			{
-				car_origin = {x * flip_mul * World::scale, y * World::scale};
-			}
+		if (car.dead)
+		{
+			kinematics.freeze(car_index);
 		}
 	}
 }
 
-void Simulation::load_checkpoints()
+void SimulationUnit::advance_clock()
 {
-	const char* fname = settings.checkpoint_path.c_str();
-	const float flip_mul = settings.flip ? -1.0 : 1.0f;
+	++ticks_elapsed;
+	seconds_elapsed += tick_seconds;
+	++profile.ticks;
+}
 
-	spdlog::info("loading checkpoints from file '{}'", fname);
+void SimulationUnit::retire_car(const std::uint32_t index)
+{
+	const std::uint32_t slot = _live_slots[index];
 
-	std::ifstream           race_config{fname, std::ios::binary};
-	Json::Value             root;
-	Json::CharReaderBuilder reader;
-	Json::parseFromStream(reader, race_config, &root, nullptr);
+	if (slot == dead_slot)
+	{
+		return;
+	}
 
-	b2BodyDef cp_bdef;
-	cp_bdef.type = b2_staticBody;
+	// swap-remove, keeping the slot of the car that got moved in sync
+	const std::uint32_t moved_index = live_cars.back();
+	live_cars[slot]                 = moved_index;
+	_live_slots[moved_index]        = slot;
 
-	checkpoint_vertices = sf::VertexArray(sf::Lines);
+	live_cars.pop_back();
+	_live_slots[index] = dead_slot;
+}
+
+void SimulationUnit::revive_cars()
+{
+	live_cars.resize(cars.size());
+	_live_slots.resize(cars.size());
 
+	for (std::uint32_t i = 0; i < cars.size(); ++i)
 	{
-		size_t i = 0;
-		for (const Json::Value& cp : root["checkpoints"])
-		{
-			sf::Vector2f p1{
-				cp["p1"].get(Json::ArrayIndex{0}, 0).asFloat() * 5.f,
-				cp["p1"].get(Json::ArrayIndex{1}, 0).asFloat() * 5.f},
-				p2{cp["p2"].get(Json::ArrayIndex{0}, 0).asFloat() * 5.f,
-				   cp["p2"].get(Json::ArrayIndex{1}, 0).asFloat() * 5.f};
+		live_cars[i]   = i;
+		_live_slots[i] = i;
+	}
+}
 
-			sf::Vector2f center{p1 + (p2 - p1) / 2.f};
+Simulation::Simulation(
+	MapSettings        settings,
+	SimulationSettings simulation_settings,
+	std::size_t        unit_count,
+	Placement&         placement) :
+	simulation_settings(simulation_settings),
+	placement(&placement),
+	units(unit_count)
+{
+	spdlog::info("reinitializing simulation");
 
-			// Extend the line by 5 pixels each side
-			p1.x += (p1.x > center.x) ? 5.f : -5.f; // @todo compact if possible
-			p2.x += (p2.x > center.x)
-				? 5.f
-				: -5.f; // for (float& x : {p1.x, p2.x} doesn't work since you can't get a reference to both
-			p1.y += (p1.y > center.y) ? 5.f : -5.f;
-			p2.y += (p2.y > center.y) ? 5.f : -5.f;
+	map = Map::load(settings);
 
-			p1.x *= flip_mul;
-			p2.x *= flip_mul;
+	const std::size_t population_size = std::size_t(simulation_settings.population_size);
 
-			const static sf::Color cp_col{0, 127, 0, 100};
+	placement.for_each_unit(units.size(), [&](const std::size_t i) {
+		SimulationUnit& unit = units[i];
+		unit.world.get().SetContactListener(&unit.contact_listener);
 
-			checkpoint_vertices.append(sf::Vertex{p1, cp_col});
-			checkpoint_vertices.append(sf::Vertex{p2, cp_col});
+		load_walls(unit);
+		load_checkpoints(unit);
 
-			b2EdgeShape cp_shape;
-			cp_shape.SetTwoSided(b2Vec2{p1.x, p1.y}, b2Vec2{p2.x, p2.y});
+		// cars are dealt round-robin, unit i getting cars i, i + unit_count, ...
+		init_cars(unit, population_size / units.size() + (i < population_size % units.size() ? 1 : 0));
+	});
 
-			b2FixtureDef cp_fdef;
-			cp_fdef.shape    = &cp_shape;
-			cp_fdef.isSensor = true;
+	cars.resize(population_size);
 
-			for (SimulationUnit& unit : units)
-			{
-				auto& cpb  = unit.world.add_body<entities::Checkpoint>(cp_bdef);
-				cpb.origin = center;
-				cpb.p1     = p1;
-				cpb.p2     = p2;
-				cpb.id     = i++;
-				cpb.add_fixture(cp_fdef);
-
-				unit.checkpoints.push_back(&cpb);
-			}
-		}
+	for (std::size_t i = 0; i < population_size; ++i)
+	{
+		cars[i] = units[i % units.size()].cars[i / units.size()];
+	}
+
+	reset();
+}
+
+void Simulation::set_map(const MapSettings& settings)
+{
+	std::shared_ptr<const Map> new_map = Map::load(settings);
+
+	if (new_map == map)
+	{
+		return;
+	}
+
+	map = std::move(new_map);
+
+	placement->for_each_unit(units.size(), [&](const std::size_t i) {
+		unload_map(units[i]);
+		load_walls(units[i]);
+		load_checkpoints(units[i]);
+	});
+}
+
+void Simulation::reset()
+{
+	switch (simulation_settings.raycast_method)
+	{
+	case RaycastMethod::DistanceField:
+	{
+		distance_field = map->distance_field(simulation_settings.distance_field_resolution);
+		spdlog::info("lidar uses a distance field, max distance error {:.2f}", distance_field->max_error());
+		break;
+	}
+
+	case RaycastMethod::Batched:
+	case RaycastMethod::Exact:
+	default:
+	{
+		distance_field = nullptr;
+		break;
+	}
 	}
 
 	for (SimulationUnit& unit : units)
 	{
-		unit.world.get().SetContactListener(&unit.contact_listener);
+		unit.control_period  = std::size_t(std::max(simulation_settings.control_period, 1));
+		unit.vehicle_model   = simulation_settings.vehicle_model;
+		unit.raycast_method  = simulation_settings.raycast_method;
+		unit.distance_field  = distance_field.get();
+		unit.wall_grid       = map->wall_grid.get();
+		unit.ticks_elapsed   = 0;
+		unit.seconds_elapsed = 0.0f;
+		unit.profile         = {};
+		unit.revive_cars();
+		unit.state.resize(unit.cars.size(), std::size_t(std::max(simulation_settings.ray_count, 1)));
+		unit.state.ray_schedule = simulation_settings.ray_schedule;
+		unit.state.ray_period   = std::size_t(std::max(simulation_settings.ray_period, 1));
+		unit.state.reset();
+		unit.ray_batch.reserve(unit.cars.size() * unit.state.ray_count());
+	}
 
-		if (settings.flip)
+	for (entities::Car* car : cars)
+	{
+		car->reset(map->car_origin, static_cast<float>(0.5 * M_PI), simulation_settings.vehicle_model);
+	}
+
+	if (simulation_settings.vehicle_model == VehicleModel::Kinematic)
+	{
+		for (SimulationUnit& unit : units)
 		{
-			std::reverse(unit.checkpoints.begin(), unit.checkpoints.end());
+			unit.kinematics.load(unit.cars);
 		}
 	}
 }
 
-void Simulation::init_cars()
+void Simulation::attach(std::vector<Individual>& population)
+{
+	for (Individual& individual : population)
+	{
+		cars[individual.car_id]->individual = &individual;
+	}
+
+	placement->for_each_node([&](const std::size_t node) {
+		const auto [first, last] = placement->unit_range(node, units.size());
+
+		tbb::parallel_for(first, last, [&](const std::size_t i) {
+			SimulationUnit& unit = units[i];
+
+			for (std::size_t car_index = 0; car_index < unit.cars.size(); ++car_index)
+			{
+				Individual* individual = unit.cars[car_index]->individual;
+
+				if (individual != nullptr)
+				{
+					// only the networks darwin rebuilt, or whose car moved to another node, need a new local copy
+					if (individual->network_node != node)
+					{
+						individual->network      = neural::Network(individual->network);
+						individual->network_node = node;
+					}
+
+					individual->network.reset_values();
+				}
+
+				unit.state.network[car_index] = individual != nullptr ? &individual->network : nullptr;
+			}
+		});
+	});
+}
+
+void Simulation::load_walls(SimulationUnit& unit)
+{
+	b2BodyDef bdef;
+	bdef.type = b2_staticBody;
+
+	unit.wall = &unit.world.add_body(bdef);
+	unit.wall->set_type(sim::entities::BodyType::BodyWall);
+
+	for (const util::Line& ln : map->walls)
+	{
+		b2EdgeShape wall_shape;
+		wall_shape.SetTwoSided({ln.p1.x, ln.p1.y}, {ln.p2.x, ln.p2.y});
+
+		b2FixtureDef fixdef;
+		fixdef.shape = &wall_shape;
+
+		unit.wall->add_fixture(fixdef);
+	}
+}
+
+void Simulation::load_checkpoints(SimulationUnit& unit)
 {
-	spdlog::info("spawning cars");
+	unit.checkpoints.reserve(map->checkpoints.size());
 
+	for (std::size_t i = 0; i < map->checkpoints.size(); ++i)
+	{
+		const CheckpointLine& line = map->checkpoints[i];
+		unit.checkpoints.push_back({i, line.origin, line.p1, line.p2, line.progress_origin, line.progress_axis});
+	}
+}
+
+void Simulation::unload_map(SimulationUnit& unit)
+{
+	unit.checkpoints.clear();
+
+	if (unit.wall != nullptr)
+	{
+		unit.world.remove_body(*unit.wall);
+		unit.wall = nullptr;
+	}
+}
+
+void Simulation::init_cars(SimulationUnit& unit, const std::size_t car_count)
+{
 	b2BodyDef bdef;
 	bdef.type           = b2_dynamicBody;
 	bdef.angularDamping = 0.01f;
 
-	std::array<b2Vec2, 8> vertices
-		= {{{-1.50f, -0.30f},
-			{-1.00f, -1.90f},
-			{-0.50f, -2.10f},
-			{0.50f, -2.10f},
-			{1.00f, -1.90f},
-			{1.50f, -0.30f},
-			{1.50f, 2.00f},
-			{-1.50f, 2.00f}}};
-
 	b2PolygonShape shape;
-	shape.Set(vertices.data(), vertices.size()); // shape.SetAsBox(1.5f, 2.1f);
+	shape.Set(entities::Car::body_vertices.data(), entities::Car::body_vertices.size()); // shape.SetAsBox(1.5f, 2.1f);
 
 	b2FixtureDef fixdef;
 	fixdef.shape             = &shape;
@@ -204,25 +357,40 @@ void Simulation::init_cars()
 	fixdef.restitution       = 0.2f;
 	fixdef.filter.groupIndex = -1;
 
-	for (std::size_t i = 0; i < 4000; ++i)
+	for (std::size_t i = 0; i < car_count; ++i)
 	{
-		SimulationUnit& unit = optimal_unit();
-		auto&           car  = unit.world.add_body<entities::Car>(bdef);
-		car.unit             = &unit;
-		cars.push_back(&car);
+		auto& car      = unit.world.add_body<entities::Car>(bdef);
+		car.unit       = &unit;
+		car.unit_index = std::uint32_t(unit.cars.size());
 		unit.cars.push_back(&car);
 
-		car.with_color(sf::Color{200, 50, 0, 50}).add_fixture(fixdef);
-		car.transform(car_origin, static_cast<float>(0.5 * M_PI));
+		car.add_fixture(fixdef);
 	}
+
+	unit.state.resize(unit.cars.size(), std::size_t(std::max(simulation_settings.ray_count, 1)));
 }
 
-SimulationUnit& Simulation::optimal_unit()
+TickProfile Simulation::profile() const
 {
-	const auto it = std::min_element(units.begin(), units.end(), [](const auto& a, const auto& b) {
-		return a.world.body_count() < b.world.body_count();
-	});
+	TickProfile profile;
+
+	for (const SimulationUnit& unit : units)
+	{
+		profile += unit.profile;
+	}
+
+	return profile;
+}
+
+std::size_t Simulation::live_car_count() const
+{
+	std::size_t count = 0;
+
+	for (const SimulationUnit& unit : units)
+	{
+		count += unit.live_car_count();
+	}
 
-	return *it;
+	return count;
 }
 } // namespace sim
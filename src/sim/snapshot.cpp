@@ -0,0 +1,24 @@
+#include <carnn/sim/snapshot.hpp>
+
+#include <carnn/sim/entities/car.hpp>
+#include <carnn/sim/individual.hpp>
+#include <carnn/sim/simulationunit.hpp>
+
+namespace sim
+{
+void CarSnapshot::capture(entities::Car& car)
+{
+	body = car.body_transform();
+
+	for (std::size_t i = 0; i < wheels.size(); ++i)
+	{
+		wheels[i] = car.wheel_transform(i);
+	}
+
+	rays.clear();
+	car.unit->state.append_ray_vertices(car.unit_index, rays);
+
+	dead               = car.dead;
+	survivor_from_last = car.individual != nullptr && car.individual->survivor_from_last;
+}
+} // namespace sim
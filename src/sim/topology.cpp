@@ -0,0 +1,176 @@
+#include <carnn/sim/topology.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <cereal/archives/json.hpp>
+#include <filesystem>
+#include <fstream>
+#include <sched.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace sim
+{
+namespace
+{
+/// Parses a kernel CPU list such as "0-7,16-23"
+std::vector<int> parse_cpu_list(const std::string& list)
+{
+	std::vector<int> cpus;
+
+	for (std::size_t begin = 0; begin < list.size();)
+	{
+		std::size_t end = list.find(',', begin);
+		end             = end == std::string::npos ? list.size() : end;
+
+		const std::string range = list.substr(begin, end - begin);
+		const std::size_t dash  = range.find('-');
+
+		try
+		{
+			const int first = std::stoi(range.substr(0, dash));
+			const int last  = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+
+			for (int cpu = first; cpu <= last; ++cpu)
+			{
+				cpus.push_back(cpu);
+			}
+		}
+		catch (const std::exception&)
+		{
+			// trailing newline or garbage, ignore it
+		}
+
+		begin = end + 1;
+	}
+
+	return cpus;
+}
+
+/// Reads the CPUs of every NUMA node from sysfs, keeping only the ones our cpuset lets us use
+std::vector<NumaNode> detect_nodes()
+{
+	std::vector<NumaNode> nodes;
+
+#ifdef __linux__
+	cpu_set_t allowed;
+	CPU_ZERO(&allowed);
+	const bool has_affinity = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+
+	std::error_code error;
+
+	std::vector<std::filesystem::path> node_paths;
+	for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error))
+	{
+		const std::string name = entry.path().filename().string();
+
+		if (name.size() > 4 && name.compare(0, 4, "node") == 0
+			&& std::all_of(name.begin() + 4, name.end(), [](unsigned char c) { return std::isdigit(c) != 0; }))
+		{
+			node_paths.push_back(entry.path());
+		}
+	}
+
+	std::sort(node_paths.begin(), node_paths.end());
+
+	for (const std::filesystem::path& path : node_paths)
+	{
+		std::ifstream is(path / "cpulist");
+		std::string   list;
+		std::getline(is, list);
+
+		NumaNode node;
+
+		for (const int cpu : parse_cpu_list(list))
+		{
+			if (!has_affinity || CPU_ISSET(cpu, &allowed))
+			{
+				node.cpus.push_back(cpu);
+			}
+		}
+
+		// memory-only nodes and nodes outside of our cpuset have nothing to run units on
+		if (!node.cpus.empty())
+		{
+			nodes.push_back(std::move(node));
+		}
+	}
+#endif
+
+	return nodes;
+}
+} // namespace
+
+Topology Topology::detect()
+{
+	Topology topology;
+
+	if (topology.load_from_file())
+	{
+		spdlog::info("using the topology from topology.json instead of probing the machine");
+		return topology;
+	}
+
+	topology.core_count = std::max(1u, std::thread::hardware_concurrency());
+
+#if defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+	// sysconf reports 0 or -1 when it does not know, in which case we keep the defaults
+	if (const long size = sysconf(_SC_LEVEL2_CACHE_SIZE); size > 0)
+	{
+		topology.l2_cache_size = std::size_t(size);
+	}
+
+	if (const long size = sysconf(_SC_LEVEL3_CACHE_SIZE); size > 0)
+	{
+		topology.l3_cache_size = std::size_t(size);
+	}
+#endif
+
+	topology.nodes = detect_nodes();
+
+	if (topology.nodes.empty())
+	{
+		topology.nodes.resize(1);
+
+		for (std::size_t cpu = 0; cpu < topology.core_count; ++cpu)
+		{
+			topology.nodes[0].cpus.push_back(int(cpu));
+		}
+	}
+
+	return topology;
+}
+
+bool Topology::load_from_file()
+{
+	std::ifstream is("topology.json", std::ios::binary);
+
+	if (!is)
+	{
+		return false;
+	}
+
+	try
+	{
+		cereal::JSONInputArchive ar(is);
+		serialize(ar);
+	}
+	catch (const cereal::Exception& e)
+	{
+		spdlog::error("failed to load topology.json: {}", e.what());
+		*this = Topology{};
+		return false;
+	}
+
+	if (nodes.empty())
+	{
+		spdlog::error("topology.json does not list any NUMA node, ignoring it");
+		*this = Topology{};
+		return false;
+	}
+
+	return true;
+}
+} // namespace sim
@@ -0,0 +1,129 @@
+#include <carnn/sim/trackrenderer.hpp>
+
+#include <algorithm>
+#include <carnn/sim/map.hpp>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <spdlog/spdlog.h>
+#include <utility>
+
+namespace sim
+{
+void TrackRenderer::set_map(std::shared_ptr<const Map> map)
+{
+	if (map == _map)
+	{
+		return;
+	}
+
+	_map = std::move(map);
+	_tiles.clear();
+
+	if (_map == nullptr)
+	{
+		return;
+	}
+
+	std::vector<sf::Vertex> lines = _map->wall_vertices;
+	for (std::size_t i = 0; i < _map->checkpoint_vertices.getVertexCount(); ++i)
+	{
+		lines.push_back(_map->checkpoint_vertices[i]);
+	}
+
+	if (lines.empty())
+	{
+		return;
+	}
+
+	sf::Vector2f min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+	sf::Vector2f max{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+	for (const sf::Vertex& vertex : lines)
+	{
+		min = {std::min(min.x, vertex.position.x), std::min(min.y, vertex.position.y)};
+		max = {std::max(max.x, vertex.position.x), std::max(max.y, vertex.position.y)};
+	}
+
+	const float tile_size = std::max({max.x - min.x, max.y - min.y, 1.0f}) / tiles_per_side;
+
+	// each line goes to the tile of its middle, so that none is drawn twice
+	std::map<std::pair<int, int>, std::size_t> tile_indices;
+
+	for (std::size_t i = 0; i + 1 < lines.size(); i += 2)
+	{
+		const sf::Vector2f middle = (lines[i].position + lines[i + 1].position) * 0.5f;
+		const std::pair<int, int> key{
+			int(std::floor((middle.x - min.x) / tile_size)),
+			int(std::floor((middle.y - min.y) / tile_size))};
+
+		auto [it, inserted] = tile_indices.try_emplace(key, _tiles.size());
+		if (inserted)
+		{
+			_tiles.push_back(std::make_unique<Tile>());
+		}
+
+		_tiles[it->second]->vertices.push_back(lines[i]);
+		_tiles[it->second]->vertices.push_back(lines[i + 1]);
+	}
+
+	_use_buffers = sf::VertexBuffer::isAvailable();
+
+	for (auto& tile : _tiles)
+	{
+		sf::Vector2f tile_min = tile->vertices[0].position, tile_max = tile_min;
+
+		for (const sf::Vertex& vertex : tile->vertices)
+		{
+			tile_min = {std::min(tile_min.x, vertex.position.x), std::min(tile_min.y, vertex.position.y)};
+			tile_max = {std::max(tile_max.x, vertex.position.x), std::max(tile_max.y, vertex.position.y)};
+		}
+
+		// padded so that axis-aligned lines, whose bounds are flat, still intersect the view
+		tile->bounds = {tile_min.x - 1.0f, tile_min.y - 1.0f, tile_max.x - tile_min.x + 2.0f, tile_max.y - tile_min.y + 2.0f};
+
+		if (_use_buffers && tile->buffer.create(tile->vertices.size()) && tile->buffer.update(tile->vertices.data()))
+		{
+			tile->vertices.clear();
+			tile->vertices.shrink_to_fit();
+		}
+		else
+		{
+			_use_buffers = false;
+		}
+	}
+
+	spdlog::info(
+		"track split into {} tiles of {:.1f} units, {}",
+		_tiles.size(),
+		tile_size,
+		_use_buffers ? "in vertex buffers" : "in vertex arrays");
+}
+
+void TrackRenderer::draw(sf::RenderTarget& target) const
+{
+	const sf::View&     view         = target.getView();
+	const sf::FloatRect visible_area = view.getInverseTransform().transformRect({-1.0f, -1.0f, 2.0f, 2.0f});
+
+	_drawn_tile_count = 0;
+
+	for (const auto& tile : _tiles)
+	{
+		if (!tile->bounds.intersects(visible_area))
+		{
+			continue;
+		}
+
+		if (tile->vertices.empty())
+		{
+			target.draw(tile->buffer);
+		}
+		else
+		{
+			target.draw(tile->vertices.data(), tile->vertices.size(), sf::Lines);
+		}
+
+		++_drawn_tile_count;
+	}
+}
+} // namespace sim
@@ -0,0 +1,183 @@
+// built without the precompiled header, see CMakeLists.txt
+#include <carnn/pch.hpp>
+
+#include <carnn/sim/wallgrid.hpp>
+
+#include <algorithm>
+#include <carnn/util/maths.hpp>
+#include <limits>
+
+namespace sim
+{
+WallGrid::WallGrid(const std::vector<util::Line>& walls, const float cell_size) : _cell_size(cell_size)
+{
+	b2Vec2 lower{std::numeric_limits<float>::max(), std::numeric_limits<float>::max()};
+	b2Vec2 upper{std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+
+	for (const util::Line& line : walls)
+	{
+		for (const sf::Vector2f& p : {line.p1, line.p2})
+		{
+			lower = {std::min(lower.x, p.x), std::min(lower.y, p.y)};
+			upper = {std::max(upper.x, p.x), std::max(upper.y, p.y)};
+		}
+	}
+
+	if (walls.empty())
+	{
+		lower = upper = {0.0f, 0.0f};
+	}
+
+	_origin = lower - b2Vec2{_cell_size, _cell_size};
+	_width  = std::size_t((upper.x - _origin.x) / _cell_size) + 2;
+	_height = std::size_t((upper.y - _origin.y) / _cell_size) + 2;
+
+	// segments are registered in every cell their bounding box overlaps. the bounding box is slightly inflated so that
+	// hits landing right on a cell boundary are seen from both sides.
+	const float margin = 1.0e-3f * _cell_size;
+
+	const auto for_each_cell = [&](const util::Line& line, auto&& func) {
+		const auto cell_coord = [&](float x, float origin, std::size_t size) {
+			return std::min(std::size_t(std::max((x - origin) / _cell_size, 0.0f)), size - 1);
+		};
+
+		const std::size_t x0 = cell_coord(std::min(line.p1.x, line.p2.x) - margin, _origin.x, _width);
+		const std::size_t x1 = cell_coord(std::max(line.p1.x, line.p2.x) + margin, _origin.x, _width);
+		const std::size_t y0 = cell_coord(std::min(line.p1.y, line.p2.y) - margin, _origin.y, _height);
+		const std::size_t y1 = cell_coord(std::max(line.p1.y, line.p2.y) + margin, _origin.y, _height);
+
+		for (std::size_t y = y0; y <= y1; ++y)
+		{
+			for (std::size_t x = x0; x <= x1; ++x)
+			{
+				func(y * _width + x);
+			}
+		}
+	};
+
+	// counting sort of the segments by cell
+	_cell_begin.assign(_width * _height + 1, 0);
+
+	for (const util::Line& line : walls)
+	{
+		for_each_cell(line, [&](std::size_t cell) { ++_cell_begin[cell + 1]; });
+	}
+
+	for (std::size_t i = 1; i < _cell_begin.size(); ++i)
+	{
+		_cell_begin[i] += _cell_begin[i - 1];
+	}
+
+	const std::size_t total = _cell_begin.back();
+	for (auto* array : {&_v1_x, &_v1_y, &_edge_x, &_edge_y, &_edge_length_squared, &_normal_x, &_normal_y})
+	{
+		array->resize(total);
+	}
+
+	std::vector<std::uint32_t> cursors(_cell_begin.begin(), _cell_begin.end() - 1);
+
+	for (const util::Line& line : walls)
+	{
+		const b2Vec2 v1{line.p1.x, line.p1.y};
+		const b2Vec2 edge = b2Vec2{line.p2.x, line.p2.y} - v1;
+
+		// matches b2Vec2::Normalize
+		const float length     = edge.Length();
+		const float inv_length = length < std::numeric_limits<float>::epsilon() ? 0.0f : 1.0f / length;
+
+		for_each_cell(line, [&](std::size_t cell) {
+			const std::uint32_t i = cursors[cell]++;
+
+			_v1_x[i]                = v1.x;
+			_v1_y[i]                = v1.y;
+			_edge_x[i]              = edge.x;
+			_edge_y[i]              = edge.y;
+			_edge_length_squared[i] = b2Dot(edge, edge);
+			_normal_x[i]            = edge.y * inv_length;
+			_normal_y[i]            = -edge.x * inv_length;
+		});
+	}
+}
+
+float WallGrid::raycast(const b2Vec2 origin, const b2Vec2 delta) const
+{
+	float closest = 1.0f;
+
+	walk(origin, delta, [&](const std::size_t cell, const float t_cell_exit) {
+		closest = closest_in_cell(cell, origin, delta, closest);
+
+		// any hit closer than the cell exit lies in a cell we already went through
+		return closest > t_cell_exit;
+	});
+
+	return closest;
+}
+
+float WallGrid::closest_in_cell(const std::size_t cell, const b2Vec2 origin, const b2Vec2 delta, float closest) const
+{
+	const std::uint32_t begin = _cell_begin[cell], end = _cell_begin[cell + 1];
+
+	// branchless so that the compiler can vectorize it; the math is the one from b2EdgeShape::RayCast
+	for (std::uint32_t i = begin; i < end; ++i)
+	{
+		const float numerator   = _normal_x[i] * (_v1_x[i] - origin.x) + _normal_y[i] * (_v1_y[i] - origin.y);
+		const float denominator = _normal_x[i] * delta.x + _normal_y[i] * delta.y;
+		const float t           = numerator / denominator;
+
+		const float q_x = (origin.x + t * delta.x) - _v1_x[i];
+		const float q_y = (origin.y + t * delta.y) - _v1_y[i];
+		const float s   = (q_x * _edge_x[i] + q_y * _edge_y[i]) / _edge_length_squared[i];
+
+		const bool hit = denominator != 0.0f && _edge_length_squared[i] != 0.0f && t >= 0.0f && t <= closest
+			&& s >= 0.0f && s <= 1.0f;
+
+		closest = hit ? t : closest;
+	}
+
+	return closest;
+}
+
+void WallGrid::closest_in_cell(const std::size_t cell, const RayLanes& rays) const
+{
+	const std::uint32_t begin = _cell_begin[cell], end = _cell_begin[cell + 1];
+
+	const float* const origin_x = rays.origin_x;
+	const float* const origin_y = rays.origin_y;
+	const float* const delta_x  = rays.delta_x;
+	const float* const delta_y  = rays.delta_y;
+	float* const       closest  = rays.closest;
+
+	for (std::uint32_t i = begin; i < end; ++i)
+	{
+		if (_edge_length_squared[i] == 0.0f)
+		{
+			continue;
+		}
+
+		const float v1_x = _v1_x[i], v1_y = _v1_y[i];
+		const float edge_x = _edge_x[i], edge_y = _edge_y[i], edge_length_squared = _edge_length_squared[i];
+		const float normal_x = _normal_x[i], normal_y = _normal_y[i];
+
+		// same math as the per ray loop above, with the segment broadcast over the rays. The ray arrays never alias.
+#if defined(__clang__)
+#pragma clang loop vectorize(assume_safety)
+#elif defined(__GNUC__)
+#pragma GCC ivdep
+#endif
+		for (std::size_t j = 0; j < rays.count; ++j)
+		{
+			const float numerator   = normal_x * (v1_x - origin_x[j]) + normal_y * (v1_y - origin_y[j]);
+			const float denominator = normal_x * delta_x[j] + normal_y * delta_y[j];
+			const float t           = numerator / denominator;
+
+			const float q_x = (origin_x[j] + t * delta_x[j]) - v1_x;
+			const float q_y = (origin_y[j] + t * delta_y[j]) - v1_y;
+			const float s   = (q_x * edge_x + q_y * edge_y) / edge_length_squared;
+
+			const bool hit = denominator != 0.0f && t >= 0.0f && t <= closest[j] && s >= 0.0f && s <= 1.0f;
+
+			closest[j] = hit ? t : closest[j];
+		}
+	}
+}
+} // namespace sim
@@ -1,5 +1,6 @@
 #include <carnn/sim/world.hpp>
 
+#include <algorithm>
 #include <carnn/util/line.hpp>
 #include <carnn/util/maths.hpp>
 
@@ -15,21 +16,19 @@ World& World::step(const float speed, const int vel_it, const int pos_it)
 
 World& World::update()
 {
-	// Update bodies
-	for (auto& b : _bodies)
+	for (entities::Car* car : _active_cars)
 	{
-		b->update();
+		car->update();
 	}
 
-	return *this;
-}
-
-World& World::render(sf::RenderTarget& target)
-{
-	// Render bodies
-	for (auto& b : _bodies)
+	if (_prune_active_cars)
 	{
-		b->render(target);
+		const auto it = std::remove_if(_active_cars.begin(), _active_cars.end(), [](entities::Car* car) {
+			return !car->get().IsEnabled();
+		});
+
+		_active_cars.erase(it, _active_cars.end());
+		_prune_active_cars = false;
 	}
 
 	return *this;
@@ -43,5 +42,60 @@ void World::update_view(sf::RenderTarget& target, sf::Vector2f origin, float czo
 	target.setView(new_view);
 }
 
+void World::disable_body(entities::Body& body)
+{
+	if (body.get().IsEnabled())
+	{
+		body.get().SetEnabled(false);
+		_prune_active_cars = _prune_active_cars || body.type() == entities::BodyType::BodyCar;
+	}
+}
+
+void World::enable_body(entities::Body& body)
+{
+	if (!body.get().IsEnabled())
+	{
+		body.get().SetEnabled(true);
+	}
+
+	if (body.type() != entities::BodyType::BodyCar)
+	{
+		return;
+	}
+
+	auto& car = static_cast<entities::Car&>(body);
+
+	if (std::find(_active_cars.begin(), _active_cars.end(), &car) == _active_cars.end())
+	{
+		_active_cars.push_back(&car);
+	}
+}
+
+void World::remove_body(entities::Body& body)
+{
+	_world.DestroyBody(&body.get());
+
+	switch (body.type())
+	{
+	case entities::BodyType::BodyCar:
+	{
+		auto&      car       = static_cast<entities::Car&>(body);
+		const auto active_it = std::find(_active_cars.begin(), _active_cars.end(), &car);
+		if (active_it != _active_cars.end())
+		{
+			_active_cars.erase(active_it);
+		}
+
+		_cars.erase(car);
+		break;
+	}
+
+	case entities::BodyType::BodyWheel: _wheels.erase(static_cast<entities::Wheel&>(body)); break;
+	case entities::BodyType::BodyAny:
+	case entities::BodyType::BodyWall:
+	default: _bodies.erase(body); break;
+	}
+}
+
 b2World& World::get() { return _world; }
 } // namespace sim
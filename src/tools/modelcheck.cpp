@@ -0,0 +1,467 @@
+#include <algorithm>
+#include <carnn/sim/entities/car.hpp>
+#include <carnn/sim/placement.hpp>
+#include <carnn/sim/settings.hpp>
+#include <carnn/sim/simulationunit.hpp>
+#include <carnn/sim/tickprofile.hpp>
+#include <carnn/sim/topology.hpp>
+#include <cereal/archives/json.hpp>
+#include <cereal/types/string.hpp>
+#include <cereal/types/vector.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <vector>
+
+// Drives a single car through the same fixed control sequences under each vehicle model, and checks that the single
+// body models follow the trajectory of the wheeled one. Then times the physics of a full population under each model.
+// Runs headless, from the directory holding map.png and map.json like the app does.
+//
+// Tolerances come from measurements: `CarNN-modelcheck --calibrate` measures the worst deviation of every sequence and
+// writes them to modelcheck.json, and the check then allows each of them `tolerance_margin` more. Exits with a
+// non-zero status when a model strays beyond that, or when there is no calibration to check against.
+
+using namespace sim;
+
+namespace
+{
+struct Controls
+{
+	std::size_t ticks;
+	float       throttle, steering, brake, drift;
+};
+
+struct Sequence
+{
+	const char*           name;
+	std::vector<Controls> controls;
+};
+
+const std::vector<Sequence> sequences = {
+	/// Straight line, a turn either way (drifting through the second one), then braking to a stop
+	{"chicane",
+	 {
+		 {6, 0.5f, 0.0f, 0.0f, 0.0f},
+		 {6, 0.5f, -0.5f, 0.0f, 0.0f},
+		 {6, 0.3f, 0.5f, 0.0f, 1.0f},
+		 {6, 0.0f, 0.0f, 1.0f, 0.0f},
+	 }},
+	/// Four turns each way without drifting, for the compliance of the wheel joints to build up
+	{"slalom",
+	 {
+		 {4, 0.6f, 0.0f, 0.0f, 0.0f},
+		 {5, 0.5f, -0.6f, 0.0f, 0.0f},
+		 {5, 0.5f, 0.6f, 0.0f, 0.0f},
+		 {5, 0.5f, -0.6f, 0.0f, 0.0f},
+		 {5, 0.5f, 0.6f, 0.0f, 0.0f},
+		 {5, 0.5f, -0.6f, 0.0f, 0.0f},
+		 {5, 0.5f, 0.6f, 0.0f, 0.0f},
+		 {5, 0.5f, -0.6f, 0.0f, 0.0f},
+		 {5, 0.5f, 0.6f, 0.0f, 0.0f},
+		 {6, 0.0f, 0.0f, 1.0f, 0.0f},
+	 }},
+	/// Hard turns either way while drifting, then a braking turn
+	{"drift",
+	 {
+		 {6, 0.7f, 0.0f, 0.0f, 0.0f},
+		 {8, 0.5f, -0.8f, 0.0f, 1.0f},
+		 {4, 0.4f, 0.0f, 0.0f, 0.0f},
+		 {8, 0.5f, 0.8f, 0.0f, 1.0f},
+		 {6, 0.3f, -0.3f, 0.2f, 0.0f},
+		 {8, 0.0f, 0.0f, 1.0f, 0.0f},
+	 }},
+	/// Long and gentle, closer to what a trained network drives
+	{"lap",
+	 {
+		 {10, 0.4f, 0.0f, 0.0f, 0.0f},
+		 {15, 0.4f, -0.25f, 0.0f, 0.0f},
+		 {10, 0.4f, 0.0f, 0.0f, 0.0f},
+		 {15, 0.4f, 0.25f, 0.0f, 0.0f},
+		 {10, 0.5f, -0.5f, 0.0f, 0.5f},
+		 {10, 0.2f, 0.5f, 0.3f, 0.0f},
+		 {20, 0.0f, 0.0f, 1.0f, 0.0f},
+	 }},
+};
+
+/// Physics step of a tick, as in App::act
+constexpr float step_seconds = 10.0f / 30.0f;
+
+/// Fewer compared ticks than this means the car hit a wall early, and the sequence proves nothing
+constexpr std::size_t min_compared_ticks = 6;
+
+/// Cars timed under each model, and ticks they are timed over, driving the "lap" sequence
+constexpr std::int32_t timed_population = 1000;
+constexpr std::size_t  timed_ticks      = 60;
+
+const char* const calibration_path = "modelcheck.json";
+
+struct Sample
+{
+	b2Vec2 position; ///< of the body origin
+	float  angle;
+	b2Vec2 velocity; ///< of the center of mass
+};
+
+/// Largest differences between two trajectories over all the ticks
+struct Deviation
+{
+	float position = 0.0f; ///< world units, the car being 3 wide and 4 long
+	float angle    = 0.0f; ///< radians
+	float velocity = 0.0f; ///< world units per second
+
+	template<class Archive>
+	void serialize(Archive& ar)
+	{
+		ar(CEREAL_NVP(position), CEREAL_NVP(angle), CEREAL_NVP(velocity));
+	}
+};
+
+/// Share of the calibrated deviation the check allows on top of it, so that the rounding of another compiler or Box2D
+/// build passes while a change that makes a model stray half as far again does not
+constexpr float tolerance_margin = 0.5f;
+
+/// Allowed even where the calibration measured no deviation at all
+constexpr Deviation tolerance_floor{0.01f, 0.001f, 0.01f};
+
+/// Worst deviation of one model from its reference, over one sequence
+struct CalibratedDeviation
+{
+	std::string sequence;
+	std::string model;
+	Deviation   worst;
+
+	template<class Archive>
+	void serialize(Archive& ar)
+	{
+		ar(CEREAL_NVP(sequence), CEREAL_NVP(model), CEREAL_NVP(worst));
+	}
+};
+
+const char* model_name(const VehicleModel model)
+{
+	switch (model)
+	{
+	case VehicleModel::Wheeled: return "wheeled";
+	case VehicleModel::SingleBody: return "single body";
+	case VehicleModel::Kinematic: return "kinematic";
+	default: return "unknown";
+	}
+}
+
+/// Holds the same controls on every live car of the unit
+void apply(SimulationUnit& unit, const Controls& controls)
+{
+	for (const std::uint32_t car_index : unit.live_cars)
+	{
+		unit.state.throttle[car_index] = controls.throttle;
+		unit.state.steering[car_index] = controls.steering;
+		unit.state.brake[car_index]    = controls.brake;
+		unit.state.drift[car_index]    = controls.drift;
+	}
+}
+
+/// Samples the car after every tick until it dies or the sequence ends
+std::vector<Sample>
+	drive(const MapSettings& map, const Sequence& sequence, const VehicleModel model, Placement& placement)
+{
+	SimulationSettings settings;
+	settings.vehicle_model   = model;
+	settings.population_size = 1;
+
+	Simulation      sim{map, settings, 1, placement};
+	SimulationUnit& unit = sim.units.front();
+	entities::Car&  car  = *sim.cars.front();
+
+	std::vector<Sample> trajectory;
+
+	for (const Controls& controls : sequence.controls)
+	{
+		for (std::size_t tick = 0; tick < controls.ticks; ++tick)
+		{
+			apply(unit, controls);
+
+			unit.scatter_controls();
+			unit.step(step_seconds);
+			unit.advance_clock();
+
+			if (car.dead)
+			{
+				return trajectory;
+			}
+
+			const b2Transform xf = car.body_transform();
+
+			const b2Vec2 velocity = model == VehicleModel::Kinematic
+				? b2Vec2{unit.kinematics.velocity_x[car.unit_index], unit.kinematics.velocity_y[car.unit_index]}
+				: car.get().GetLinearVelocity();
+
+			trajectory.push_back({xf.p, xf.q.GetAngle(), velocity});
+		}
+	}
+
+	return trajectory;
+}
+
+/// Computes the worst deviation of `candidate` from `reference`, returning false when they cannot be compared
+bool measure(
+	const Sequence&            sequence,
+	const std::vector<Sample>& reference,
+	const VehicleModel         reference_model,
+	const std::vector<Sample>& candidate,
+	const VehicleModel         candidate_model,
+	Deviation&                 worst)
+{
+	if (reference.size() != candidate.size())
+	{
+		spdlog::error(
+			"{}: {} car drove {} ticks, {} car {} ticks",
+			sequence.name,
+			model_name(reference_model),
+			reference.size(),
+			model_name(candidate_model),
+			candidate.size());
+		return false;
+	}
+
+	if (reference.size() < min_compared_ticks)
+	{
+		spdlog::error(
+			"{}: only {} ticks to compare, the sequence runs into a wall on this map",
+			sequence.name,
+			reference.size());
+		return false;
+	}
+
+	worst = {};
+
+	for (std::size_t tick = 0; tick < reference.size(); ++tick)
+	{
+		const Sample &a = reference[tick], &b = candidate[tick];
+
+		worst.position = std::max(worst.position, (a.position - b.position).Length());
+		worst.angle    = std::max(worst.angle, std::abs(std::remainder(a.angle - b.angle, 2.0f * float(M_PI))));
+		worst.velocity = std::max(worst.velocity, (a.velocity - b.velocity).Length());
+	}
+
+	return true;
+}
+
+/// Finds the calibrated deviation of a model on a sequence, or returns nullptr
+const Deviation* find_calibration(
+	const std::vector<CalibratedDeviation>& calibration, const Sequence& sequence, const VehicleModel model)
+{
+	const auto it = std::find_if(calibration.begin(), calibration.end(), [&](const CalibratedDeviation& entry) {
+		return entry.sequence == sequence.name && entry.model == model_name(model);
+	});
+
+	return it != calibration.end() ? &it->worst : nullptr;
+}
+
+bool load_calibration(std::vector<CalibratedDeviation>& calibration)
+{
+	try
+	{
+		std::ifstream            is(calibration_path, std::ios::binary);
+		cereal::JSONInputArchive ar(is);
+		ar(cereal::make_nvp("deviations", calibration));
+	}
+	catch (const cereal::Exception& e)
+	{
+		spdlog::error("could not read {}, run with --calibrate first: {}", calibration_path, e.what());
+		return false;
+	}
+
+	return true;
+}
+
+void save_calibration(const std::vector<CalibratedDeviation>& calibration)
+{
+	std::ofstream             os(calibration_path, std::ios::binary);
+	cereal::JSONOutputArchive ar(os);
+	ar(cereal::make_nvp("deviations", calibration));
+
+	spdlog::info("wrote the {} measured deviations to {}", calibration.size(), calibration_path);
+}
+
+/// Whether `measured` stays within the calibrated deviation plus the margin, logging both
+bool check(const Sequence& sequence, const VehicleModel model, const Deviation& measured, const Deviation& calibrated)
+{
+	const auto tolerance = [](const float worst, const float floor) {
+		return std::max(worst * (1.0f + tolerance_margin), floor);
+	};
+
+	const Deviation allowed{
+		tolerance(calibrated.position, tolerance_floor.position),
+		tolerance(calibrated.angle, tolerance_floor.angle),
+		tolerance(calibrated.velocity, tolerance_floor.velocity)};
+
+	const bool agrees = measured.position <= allowed.position && measured.angle <= allowed.angle
+		&& measured.velocity <= allowed.velocity;
+
+	const auto log = agrees ? spdlog::level::info : spdlog::level::err;
+
+	spdlog::log(
+		log,
+		"{}: {} car {} its reference, position {:.4f} (tolerance {:.4f}), angle {:.4f} ({:.4f}), velocity {:.4f} "
+		"({:.4f})",
+		sequence.name,
+		model_name(model),
+		agrees ? "follows" : "strays from",
+		measured.position,
+		allowed.position,
+		measured.angle,
+		allowed.angle,
+		measured.velocity,
+		allowed.velocity);
+
+	return agrees;
+}
+
+/// Time the "Physics" phase of TickProfile took per tick, with `timed_population` cars driving the same controls
+std::chrono::nanoseconds time_physics(const MapSettings& map, const VehicleModel model, Placement& placement)
+{
+	SimulationSettings settings;
+	settings.vehicle_model   = model;
+	settings.population_size = timed_population;
+
+	Simulation      sim{map, settings, 1, placement};
+	SimulationUnit& unit = sim.units.front();
+
+	const Sequence& sequence = sequences.back();
+
+	std::size_t ticks = 0;
+
+	for (const Controls& controls : sequence.controls)
+	{
+		for (std::size_t tick = 0; tick < controls.ticks && ticks < timed_ticks; ++tick, ++ticks)
+		{
+			apply(unit, controls);
+			unit.scatter_controls();
+
+			{
+				ScopedPhase phase{unit.profile, TickPhase::Physics};
+				unit.step(step_seconds);
+			}
+
+			unit.advance_clock();
+		}
+	}
+
+	spdlog::info(
+		"{}: {} cars left out of {} after {} ticks",
+		model_name(model),
+		unit.live_car_count(),
+		timed_population,
+		ticks);
+
+	return unit.profile[TickPhase::Physics] / std::max<std::size_t>(ticks, 1);
+}
+} // namespace
+
+int main(int argc, char** argv)
+{
+	const bool calibrate = argc > 1 && std::string(argv[1]) == "--calibrate";
+
+	const MapSettings map{"map.png", "map.json", true};
+
+	Placement placement{Topology::detect(), 1};
+
+	std::vector<CalibratedDeviation> calibration;
+
+	if (!calibrate && !load_calibration(calibration))
+	{
+		return EXIT_FAILURE;
+	}
+
+	std::vector<CalibratedDeviation> measured;
+
+	bool agrees = true;
+
+	for (const Sequence& sequence : sequences)
+	{
+		const std::vector<Sample> wheeled     = drive(map, sequence, VehicleModel::Wheeled, placement);
+		const std::vector<Sample> single_body = drive(map, sequence, VehicleModel::SingleBody, placement);
+		const std::vector<Sample> kinematic   = drive(map, sequence, VehicleModel::Kinematic, placement);
+
+		const auto compare = [&](const std::vector<Sample>& reference,
+								 const VehicleModel         reference_model,
+								 const std::vector<Sample>& candidate,
+								 const VehicleModel         candidate_model) {
+			Deviation worst;
+
+			if (!measure(sequence, reference, reference_model, candidate, candidate_model, worst))
+			{
+				agrees = false;
+				return;
+			}
+
+			measured.push_back({sequence.name, model_name(candidate_model), worst});
+
+			if (calibrate)
+			{
+				spdlog::info(
+					"{}: {} car against {} over {} ticks, position {:.4f}, angle {:.4f}, velocity {:.4f}",
+					sequence.name,
+					model_name(candidate_model),
+					model_name(reference_model),
+					reference.size(),
+					worst.position,
+					worst.angle,
+					worst.velocity);
+			}
+			else if (const Deviation* calibrated = find_calibration(calibration, sequence, candidate_model))
+			{
+				agrees = check(sequence, candidate_model, worst, *calibrated) && agrees;
+			}
+			else
+			{
+				spdlog::error(
+					"{}: no calibration for the {} car, run with --calibrate",
+					sequence.name,
+					model_name(candidate_model));
+				agrees = false;
+			}
+		};
+
+		compare(wheeled, VehicleModel::Wheeled, single_body, VehicleModel::SingleBody);
+
+		// the kinematic model integrates the single body one outside of Box2D, so that is what it should follow
+		compare(single_body, VehicleModel::SingleBody, kinematic, VehicleModel::Kinematic);
+	}
+
+	if (calibrate)
+	{
+		if (!agrees)
+		{
+			spdlog::error("not writing {}, some sequences could not be compared", calibration_path);
+			return EXIT_FAILURE;
+		}
+
+		save_calibration(measured);
+	}
+
+	// what the simpler models are for: stepping the cars for less
+	const std::chrono::nanoseconds wheeled_physics = time_physics(map, VehicleModel::Wheeled, placement);
+
+	spdlog::info(
+		"wheeled: physics takes {:.3f} ms per tick for {} cars",
+		std::chrono::duration<double, std::milli>(wheeled_physics).count(),
+		timed_population);
+
+	for (const VehicleModel model : {VehicleModel::SingleBody, VehicleModel::Kinematic})
+	{
+		const std::chrono::nanoseconds physics = time_physics(map, model, placement);
+
+		spdlog::info(
+			"{}: physics takes {:.3f} ms per tick for {} cars, {:.2f}x less than wheeled",
+			model_name(model),
+			std::chrono::duration<double, std::milli>(physics).count(),
+			timed_population,
+			double(wheeled_physics.count()) / double(std::max<std::int64_t>(physics.count(), 1)));
+	}
+
+	return agrees ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <carnn/sim/carstatetable.hpp>
+#include <carnn/sim/entities/body.hpp>
+#include <carnn/sim/map.hpp>
+#include <carnn/sim/placement.hpp>
+#include <carnn/sim/raybatch.hpp>
+#include <carnn/sim/settings.hpp>
+#include <carnn/sim/simulationunit.hpp>
+#include <carnn/sim/topology.hpp>
+#include <carnn/sim/wallgrid.hpp>
+#include <cmath>
+#include <cstdlib>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+// Casts the same rays through Box2D, the way the Exact lidar does, and through the WallGrid of the Batched lidar, on
+// every map the app ships with. Rays fan out from the spawn point and from the middle of every checkpoint line, so that
+// they cover the track. Runs headless from the directory holding map.png and map.json, and exits with a non-zero status
+// when the two disagree by more than the tolerance below.
+
+using namespace sim;
+
+namespace
+{
+/// Both compute the intersection the way b2EdgeShape::RayCast does, so they may only differ by the rounding of a few
+/// operations on a fraction of at most 1. This leaves room for fused multiply-adds on one side and not the other.
+constexpr float max_fraction_difference = 1.0e-4f;
+
+/// Rays cast from each origin, evenly spread over a full turn
+constexpr std::size_t rays_per_origin = 720;
+
+/// Same as the RayCastCallback of the Exact lidar: keeps the closest wall, ignoring the cars
+class WallRayCastCallback : public b2RayCastCallback
+{
+	public:
+	float ReportFixture(
+		b2Fixture* fixture, [[maybe_unused]] const b2Vec2& point, [[maybe_unused]] const b2Vec2& normal, float fraction)
+	{
+		auto& data = *reinterpret_cast<entities::BodyUserData*>(fixture->GetBody()->GetUserData().pointer);
+		if (data.type == entities::BodyType::BodyWall)
+		{
+			closest_fraction = fraction;
+			return fraction;
+		}
+
+		return -1;
+	}
+
+	float closest_fraction = 1.0f;
+};
+
+/// Returns whether every ray cast on this map agrees within `max_fraction_difference`
+bool check_map(const MapSettings& map_settings, Placement& placement)
+{
+	SimulationSettings settings;
+	settings.population_size = 1;
+	settings.raycast_method  = RaycastMethod::Exact;
+
+	Simulation sim{map_settings, settings, 1, placement};
+	b2World&   world = sim.units.front().world.get();
+	const Map& map   = *sim.map;
+
+	std::vector<b2Vec2> origins{map.car_origin};
+	for (const CheckpointLine& checkpoint : map.checkpoints)
+	{
+		const sf::Vector2f middle = (checkpoint.p1 + checkpoint.p2) / 2.0f;
+		origins.push_back({middle.x, middle.y});
+	}
+
+	CarStateTable state;
+	state.resize(1, rays_per_origin);
+
+	RayBatch batch;
+	batch.reserve(rays_per_origin);
+
+	float       worst = 0.0f;
+	b2Vec2      worst_origin{0.0f, 0.0f}, worst_delta{0.0f, 0.0f};
+	std::size_t misses = 0, hits = 0;
+
+	for (const b2Vec2 origin : origins)
+	{
+		batch.clear();
+
+		std::vector<float> exact(rays_per_origin);
+
+		for (std::uint32_t ray = 0; ray < rays_per_origin; ++ray)
+		{
+			const float  angle = 2.0f * float(M_PI) * float(ray) / float(rays_per_origin);
+			const b2Vec2 delta = CarStateTable::ray_radius * b2Vec2{std::cos(angle), std::sin(angle)};
+
+			WallRayCastCallback raycast;
+			world.RayCast(&raycast, origin, origin + delta);
+			exact[ray] = raycast.closest_fraction;
+
+			batch.add(0, ray, origin, origin + delta);
+		}
+
+		batch.cast(*map.wall_grid, state);
+
+		for (std::uint32_t ray = 0; ray < rays_per_origin; ++ray)
+		{
+			const float difference = std::abs(state.ray_fraction[ray][0] - exact[ray]);
+
+			if (difference > max_fraction_difference)
+			{
+				++misses;
+			}
+
+			if (exact[ray] < 1.0f)
+			{
+				++hits;
+			}
+
+			if (difference > worst)
+			{
+				const float angle = 2.0f * float(M_PI) * float(ray) / float(rays_per_origin);
+
+				worst        = difference;
+				worst_origin = origin;
+				worst_delta  = CarStateTable::ray_radius * b2Vec2{std::cos(angle), std::sin(angle)};
+			}
+		}
+	}
+
+	const std::size_t ray_count = origins.size() * rays_per_origin;
+
+	spdlog::info(
+		"{}{}: {} rays from {} origins, {} hitting a wall, largest difference {:.2e} (tolerance {:.0e})",
+		map_settings.map_path,
+		map_settings.flip ? " (flipped)" : "",
+		ray_count,
+		origins.size(),
+		hits,
+		worst,
+		max_fraction_difference);
+
+	if (misses != 0)
+	{
+		spdlog::error(
+			"{} rays disagree, the worst going from ({:.2f}, {:.2f}) towards ({:.2f}, {:.2f})",
+			misses,
+			worst_origin.x,
+			worst_origin.y,
+			worst_delta.x,
+			worst_delta.y);
+	}
+
+	return misses == 0;
+}
+} // namespace
+
+int main()
+{
+	// the map pool of the app
+	const std::vector<MapSettings> maps{
+		{"map.png", "map.json", true},
+		{"map.png", "map.json", false},
+	};
+
+	Placement placement{Topology::detect(), 1};
+
+	bool agrees = true;
+
+	for (const MapSettings& map : maps)
+	{
+		agrees = check_map(map, placement) && agrees;
+	}
+
+	return agrees ? EXIT_SUCCESS : EXIT_FAILURE;
+}
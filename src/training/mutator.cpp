@@ -122,6 +122,9 @@ void Mutator::darwin(sim::Simulation& sim, std::vector<sim::Individual>& individ
 				individuals[util::random_int(0, settings.round_survivors - 1)].network);
 
 			mutate(individual.network);
+
+			// built on this thread, Simulation::attach moves it back to the node of its car
+			individual.network_node = sim::Individual::no_node;
 		}
 	}
 }
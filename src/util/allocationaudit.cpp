@@ -0,0 +1,76 @@
+#include <carnn/util/allocationaudit.hpp>
+
+#ifdef CARNN_ALLOCATION_AUDIT
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace util
+{
+namespace
+{
+// constant-initialized, so that it is safe to touch from operator new before anything else got initialized
+thread_local std::size_t allocations = 0;
+
+void* allocate(const std::size_t size)
+{
+	++allocations;
+
+	if (void* p = std::malloc(size != 0 ? size : 1))
+	{
+		return p;
+	}
+
+	throw std::bad_alloc();
+}
+
+void* allocate(const std::size_t size, const std::align_val_t alignment)
+{
+	++allocations;
+
+	// aligned_alloc wants the size to be a multiple of the alignment
+	const auto align   = static_cast<std::size_t>(alignment);
+	const auto rounded = (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+
+	if (void* p = std::aligned_alloc(align, rounded))
+	{
+		return p;
+	}
+
+	throw std::bad_alloc();
+}
+} // namespace
+
+std::size_t thread_allocation_count() { return allocations; }
+} // namespace util
+
+void* operator new(const std::size_t size) { return util::allocate(size); }
+void* operator new[](const std::size_t size) { return util::allocate(size); }
+void* operator new(const std::size_t size, const std::align_val_t alignment) { return util::allocate(size, alignment); }
+void* operator new[](const std::size_t size, const std::align_val_t alignment)
+{
+	return util::allocate(size, alignment);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+// Box2D is linked statically and allocates everything through b2Alloc, which forwards to b2Alloc_Default. The build
+// has the linker route the calls to b2Alloc_Default(int) here instead, see CMakeLists.txt.
+extern "C" void* __real__Z15b2Alloc_Defaulti(std::int32_t size);
+
+extern "C" void* __wrap__Z15b2Alloc_Defaulti(const std::int32_t size)
+{
+	++util::allocations;
+	return __real__Z15b2Alloc_Defaulti(size);
+}
+
+#endif